@@ -42,6 +42,18 @@
 #include "ns3/flow-monitor-module.h"
 #include<iostream>
 #include<fstream>
+#include "flow-stats-collector.h"
+#include "results-store.h"
+#include "traffic-matrix.h"
+#include "async-pcap-writer.h"
+#include "benchmark-report.h"
+#include "simulator-profiler.h"
+#include "ladder-scheduler.h"
+#include "cached-loss-model.h"
+#include "table-error-rate-model.h"
+/* This program replaces operator new with the pool (packet-pool.h). */
+#define PACKET_POOL_REPLACE_NEW
+#include "packet-pool.h"
 
 NS_LOG_COMPONENT_DEFINE ("wifi-tcp-b");
 
@@ -65,24 +77,28 @@ int
 main(int argc, char *argv[])
 {
 
-  ofstream out;
-  out.open("report.csv");
-  
-  out<<"percentage,"<<"Aver. Throughput,"<<"Total packets sent,"<<"Total packets received,"<<"Traffic dropped(%),"<<"Traffic Dropped(Rate),"<<"Aver. delay,"<<"Delay Std. Dev,"<<"Aver. Jitters,"<<"Jitters Std. Dev\n";
-
-
   double percentage=0.10;
   // while(percentage<=0.90)
   // {
 
-    out<<percentage*100<<",";
-
   uint32_t payloadSize = 1472;                       /* Transport layer payload size in bytes. */
   std::string dataRate = "1Mbps";                  /* Application layer datarate. */
   std::string tcpVariant = "ns3::TcpNewReno";        /* TCP variant type. */
   std::string phyRate = "HtMcs7";                    /* Physical layer bitrate. */
   double simulationTime = 10;                        /* Simulation time in seconds. */
   bool pcapTracing = true;                          /* PCAP Tracing is enabled or not. */
+  uint32_t pcapSnapLen = 65535;                      /* Bytes captured per frame; 64 keeps the MAC header. */
+  std::string pcapFrames = "all";                    /* Frame types captured: data,control,beacon,management. */
+  std::string trafficMatrix;                         /* Traffic matrix file, empty for all pairs. */
+  std::string output = "csv";                        /* csv: report.csv and FlowMonitor XML, columnar: resultsFile. */
+  std::string resultsFile = "report.wres";           /* Columnar results file, one row group per run. */
+  std::string benchmark;                             /* Benchmark bands file, empty for no benchmark. */
+  bool recordBenchmark = false;                      /* Write the bands file from this run instead of checking it. */
+  bool profile = false;                              /* Print the simulator profile at the end. */
+  std::string scheduler = "map";                     /* Event scheduler: map, heap, list, calendar or ladder. */
+  bool lossCache = true;                             /* Cache the path loss of the static node pairs. */
+  bool errorTables = true;                           /* Error rates from precomputed SNR tables. */
+  bool packetPool = true;                            /* Recycle packet allocations through free lists. */
 
 
   /* Command line argument parser setup. */
@@ -93,8 +109,35 @@ main(int argc, char *argv[])
   cmd.AddValue ("phyRate", "Physical layer bitrate", phyRate);
   cmd.AddValue ("simulationTime", "Simulation time in seconds", simulationTime);
   cmd.AddValue ("pcap", "Enable/disable PCAP Tracing", pcapTracing);
+  cmd.AddValue ("pcapSnapLen", "Bytes captured per frame, e.g. 64 for the MAC header only", pcapSnapLen);
+  cmd.AddValue ("pcapFrames", "Comma-separated frame types to capture: data, control, beacon, management or all", pcapFrames);
+  cmd.AddValue ("trafficMatrix", "Traffic matrix file, one \"src dst rateMbps\" per line (default: all pairs)", trafficMatrix);
+  cmd.AddValue ("output", "Results format: csv (report.csv and FlowMonitor XML) or columnar", output);
+  cmd.AddValue ("resultsFile", "File the columnar output appends to (read it with results-dump)", resultsFile);
+  cmd.AddValue ("benchmark", "Check the run against this bands file", benchmark);
+  cmd.AddValue ("recordBenchmark", "Write the --benchmark bands file from this run instead of checking it", recordBenchmark);
+  cmd.AddValue ("profile", "Print the simulator profile (events, queue depth, cost per callback)", profile);
+  cmd.AddValue ("lossCache", "Compute the path loss of each node pair once", lossCache);
+  cmd.AddValue ("errorTables", "Read the frame error rates from precomputed SNR tables", errorTables);
+  cmd.AddValue ("scheduler", "Event scheduler: map, heap, list, calendar or ladder", scheduler);
+  cmd.AddValue ("packetPool", "Recycle the packet, tag, event and callback allocations through per-thread free lists", packetPool);
   cmd.Parse (argc, argv);
 
+  PacketPool::Enable (packetPool);
+
+  SelectScheduler (scheduler);
+  BenchmarkReport report ("80211b");
+  if (!benchmark.empty ())
+    {
+      report.Start ();
+    }
+  if (profile)
+    {
+      ProfilingScheduler::Enable ();
+    }
+  NS_ABORT_MSG_IF (output != "csv" && output != "columnar", "Unknown --output " << output);
+  bool columnar = (output == "columnar");
+
   /* No fragmentation and no RTS/CTS */
   Config::SetDefault ("ns3::WifiRemoteStationManager::FragmentationThreshold", StringValue ("999999"));
   // Config::SetDefault ("ns3::WifiRemoteStationManager::RtsCtsThreshold", StringValue ("1000"));
@@ -118,13 +161,23 @@ main(int argc, char *argv[])
   YansWifiPhyHelper wifiPhy = YansWifiPhyHelper::Default();
   // ns-3 supports RadioTap and Prism tracing extensions for 802.11
   wifiPhy.SetPcapDataLinkType(YansWifiPhyHelper::DLT_IEEE802_11_RADIO);
+  if (errorTables)
+    {
+      // The same NIST model, read from precomputed tables.
+      wifiPhy.SetErrorRateModel ("ns3::TableErrorRateModel", "Inner", StringValue ("ns3::NistErrorRateModel"));
+    }
 
   YansWifiChannelHelper wifiChannel;
   // reference loss must be changed since 802.11b is operating at 2.4GHz
   wifiChannel.SetPropagationDelay ("ns3::ConstantSpeedPropagationDelayModel");
   wifiChannel.AddPropagationLoss("ns3::LogDistancePropagationLossModel", "ReferenceLoss", DoubleValue (40.0459));
 
-  wifiPhy.SetChannel(wifiChannel.Create());
+  Ptr<YansWifiChannel> channel = wifiChannel.Create();
+  if (lossCache)
+    {
+      CachedPropagationLossModel::Install (channel);
+    }
+  wifiPhy.SetChannel(channel);
 
   //Add a non-Qos upper mac, and disable the rate control
   NqosWifiMacHelper wifiMac = NqosWifiMacHelper::Default();
@@ -179,25 +232,13 @@ main(int argc, char *argv[])
   // sink = StaticCast<PacketSink> (sinkApp.Get(0));
 
   /* Install TCP/UDP Transmitter on the station */  
-  ApplicationContainer serverApp;
-  // srand(time(NULL));
-          
-  for(int sender=0;sender<8;sender++)
-  {
-
-    double valself=0.65/56.0;
-    for(int rcv=0;rcv<8;rcv++)
-    {                
-        if(sender==rcv) continue;
-        OnOffHelper server ("ns3::TcpSocketFactory", (InetSocketAddress (staInterface.GetAddress (rcv), 9)));
-        server.SetAttribute ("PacketSize", UintegerValue (payloadSize));
-        server.SetAttribute ("OnTime", StringValue ("ns3::ConstantRandomVariable[Constant=1]"));
-        server.SetAttribute ("OffTime", StringValue ("ns3::ConstantRandomVariable[Constant=0]"));
-        server.SetAttribute ("DataRate", DataRateValue (DataRate (std::to_string(valself)+"Mbps")));
-        serverApp.Add(server.Install(staNodes.Get(sender)));    
-    }            
-  }
- 
+  TrafficMatrix matrix = trafficMatrix.empty () ? TrafficMatrix::AllPairs (8, 0.65e6)
+                                                : TrafficMatrix::Load (trafficMatrix, 8);
+  TrafficMatrixInstaller server ("ns3::TcpSocketFactory", 9);
+  server.SetAttribute ("PacketSize", UintegerValue (payloadSize));
+  server.SetAttribute ("OnTime", StringValue ("ns3::ConstantRandomVariable[Constant=1]"));
+  server.SetAttribute ("OffTime", StringValue ("ns3::ConstantRandomVariable[Constant=0]"));
+  ApplicationContainer serverApp = server.Install (matrix, staNodes, staInterface);
 
   sinkApp.Start (Seconds (0.0));
   sinkApp.Stop (Seconds (simulationTime + 1));
@@ -222,78 +263,109 @@ main(int argc, char *argv[])
    
        
 
-  Ptr<FlowMonitor> flowMonitor = flowHelper.InstallAll();
-  Ptr<FlowMonitor> flowMonitor2 = flowHelper.Install(ap);
+  /* The FlowMonitors are only needed for the XML dumps of the csv output. */
+  Ptr<FlowMonitor> flowMonitor;
+  Ptr<FlowMonitor> flowMonitor2;
+  if (!columnar)
+    {
+      flowMonitor = flowHelper.InstallAll();
+      flowMonitor2 = flowHelper.Install(ap);
+    }
+
+  /* Streaming per-flow statistics, keyed by the FlowMonitor's flow ids */
+  FlowStatsCollector flowStats;
+  if (!columnar)
+    {
+      flowStats.SetClassifier (DynamicCast<Ipv4FlowClassifier> (flowHelper.GetClassifier ()));
+    }
+  flowStats.Install (ap);
+  flowStats.Install (staNodes);
   // Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier>(flowHelper.GetClassifier()); 
   // Ptr<FlowMonitor> monitor1 = flowHelper.GetMonitor();
   // flowMonitor->SetFlowClassifier(classifier);
   // Ptr<FlowMonitor> fm=flowHelper.InstallAll(ap.get(0));
   
 
-   // Enable Traces 
+   // Enable Traces, written by a background thread
+  AsyncPcapWriter pcap;
   if (pcapTracing)
     {
-      wifiPhy.SetPcapDataLinkType (YansWifiPhyHelper::DLT_IEEE802_11_RADIO);
-      wifiPhy.EnablePcap ("AccessPoint", apDevices);
-      wifiPhy.EnablePcap ("Station", staDevices);
+      pcap.SetSnapLength (pcapSnapLen);
+      pcap.SetFrameTypes (AsyncPcapWriter::ParseFrameTypes (pcapFrames));
+      pcap.EnableWifi ("AccessPoint", apDevices);
+      pcap.EnableWifi ("Station", staDevices);
     }
   
   /* Start Simulation */
 
   Simulator::Stop (Seconds (simulationTime + 1));
   Simulator::Run ();
+  pcap.Close ();
 
   double total=0;
-  flowMonitor->CheckForLostPackets ();
-  Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier> (flowHelper.GetClassifier ());
-  std::map<FlowId, FlowMonitor::FlowStats> stats = flowMonitor->GetFlowStats ();
-
-  double Jitters[16];
-  double RxPackets[16];
-  double TxPackets[16];
-  double DelaySum[16];
-  Ipv4Address source[16];
-  Ipv4Address destination[16];
-  
-  // double th_put[16];
+  if (!columnar)
+    {
+      flowMonitor->CheckForLostPackets ();
+    }
+
+  ResultsRowGroup group;
+  uint32_t colFlow = group.AddColumn ("flowId");
+  uint32_t colSrc = group.AddColumn ("srcAddr");
+  uint32_t colDst = group.AddColumn ("dstAddr");
+  uint32_t colSrcPort = group.AddColumn ("srcPort");
+  uint32_t colDstPort = group.AddColumn ("dstPort");
+  uint32_t colProto = group.AddColumn ("protocol");
+  uint32_t colTxPackets = group.AddColumn ("txPackets");
+  uint32_t colRxPackets = group.AddColumn ("rxPackets");
+  uint32_t colTxBytes = group.AddColumn ("txBytes");
+  uint32_t colRxBytes = group.AddColumn ("rxBytes");
+  uint32_t colDelay = group.AddColumn ("delayMean");
+  uint32_t colDelayStd = group.AddColumn ("delayStd");
+  uint32_t colJitter = group.AddColumn ("jitterMean");
+  uint32_t colJitterStd = group.AddColumn ("jitterStd");
+  uint32_t colTput = group.AddColumn ("throughputKbps");
 
-  double sum_delay=0;
   double sum_rxpackets=0;
   double sum_txpackets=0;
-  double sum_jitters=0;
+  SampleStats delays;
+  SampleStats jitters;
 
+  for (FlowId id = 1; id <= flowStats.GetNFlows (); ++id){
+      const FlowStatsCollector::FlowRecord &flow = flowStats.GetFlow (id);
 
-  for (std::map<FlowId, FlowMonitor::FlowStats>::const_iterator iter = stats.begin (); iter != stats.end (); ++iter){
-    // cout<<iter->first;
+      NS_LOG_UNCOND("Flow ID: " << id << " Src Addr " << flow.tuple.sourceAddress << " Dst Addr " << flow.tuple.destinationAddress);
+      NS_LOG_UNCOND("Tx Packets = " << flow.txPackets);
+      NS_LOG_UNCOND("Rx Packets = " << flow.rxPackets);
+      NS_LOG_UNCOND("Mean Jitter = " << flow.jitter.GetMean () << "s");
 
-
-      Ipv4FlowClassifier::FiveTuple t = classifier->FindFlow (iter->first);
-
-      int index=iter->first-1;
-      source[index]=t.sourceAddress;
-      destination[index]=t.destinationAddress;
-      TxPackets[index]=iter->second.txPackets;
-      RxPackets[index]=iter->second.rxPackets;
-      Jitters[index]=iter->second.jitterSum.GetNanoSeconds();
-      DelaySum[index]=iter->second.delaySum.GetNanoSeconds();
-
-      NS_LOG_UNCOND("Flow ID: " << iter->first << " Src Addr " << t.sourceAddress << " Dst Addr " << t.destinationAddress);
-      NS_LOG_UNCOND("Tx Packets = " << iter->second.txPackets);
-      NS_LOG_UNCOND("Rx Packets = " << iter->second.rxPackets);
-      NS_LOG_UNCOND("Jitter Sum = " << iter->second.jitterSum);
-
-      double tput=iter->second.rxBytes * 8.0 / (iter->second.timeLastRxPacket.GetSeconds()-iter->second.timeFirstTxPacket.GetSeconds()) / 1024 ;
+      /* A flow that delivered nothing has no receive time to divide by. */
+      double tput = flow.rxPackets > 0 && flow.lastRx > flow.firstTx
+        ? flow.rxBytes * 8.0 / (flow.lastRx.GetSeconds()-flow.firstTx.GetSeconds()) / 1024 : 0;
       NS_LOG_UNCOND("Throughput: " << tput << " Kbps");
-      NS_LOG_UNCOND("DelaySum = " << iter->second.delaySum);
-      // th_put[index]=tput;
+      NS_LOG_UNCOND("Mean Delay = " << flow.delay.GetMean () << "s");
 
-      sum_delay+=DelaySum[index];
-      sum_rxpackets+=RxPackets[index];
-      sum_txpackets+=TxPackets[index];
-      sum_jitters+=Jitters[index];
+      sum_rxpackets+=flow.rxPackets;
+      sum_txpackets+=flow.txPackets;
+      delays.Merge (flow.delay);
+      jitters.Merge (flow.jitter);
 
       total+=tput;
-        
+
+      group.Append (colFlow, id);
+      group.Append (colSrc, flow.tuple.sourceAddress.Get ());
+      group.Append (colDst, flow.tuple.destinationAddress.Get ());
+      group.Append (colSrcPort, flow.tuple.sourcePort);
+      group.Append (colDstPort, flow.tuple.destinationPort);
+      group.Append (colProto, flow.tuple.protocol);
+      group.Append (colTxPackets, flow.txPackets);
+      group.Append (colRxPackets, flow.rxPackets);
+      group.Append (colTxBytes, flow.txBytes);
+      group.Append (colRxBytes, flow.rxBytes);
+      group.Append (colDelay, flow.delay.GetMean ());
+      group.Append (colDelayStd, flow.delay.GetStddev ());
+      group.Append (colJitter, flow.jitter.GetMean ());
+      group.Append (colJitterStd, flow.jitter.GetStddev ());
+      group.Append (colTput, tput);
   }
   NS_LOG_UNCOND("Total throughput"<<total);
 
@@ -303,45 +375,18 @@ main(int argc, char *argv[])
 
 NS_LOG_UNCOND("\n\nReport\n\n");
 
-double mean_jitters=(sum_jitters)/(sum_rxpackets-1);
+/* Per-packet statistics over every flow, in milliseconds. */
+double mean_jitters=jitters.GetMean ()*1e3;
 NS_LOG_UNCOND("mean jitters="<<mean_jitters);
 
-double mean_delay=(sum_delay)/(sum_rxpackets);
-
-
-double variance_delay=0;
-double variance_jitters=0;
-for(int i=0;i<16;i++)
-{
-  if(RxPackets[i]>=2)
-    {
-      double temp=abs((Jitters[i])/(RxPackets[i]-1)-mean_jitters);
-      // NS_LOG_UNCOND("temp="<<temp<<" "<<"index"<<i<<" "<<Jitters[i]);
-      variance_jitters+=temp*temp;
-
-      
-    }
-    if(RxPackets[i]>0)
-    {
-      double temp2=abs((DelaySum[i])/(RxPackets[i])-mean_delay);
-      variance_delay+=temp2*temp2;
-
-    }
-    
-  
+double mean_delay=delays.GetMean ()*1e3;
 
-}
-variance_jitters=variance_jitters/16;
-variance_delay=variance_delay/16;
-
-NS_LOG_UNCOND("variance jitters="<<variance_jitters);
-double deviation_jitters=sqrt(variance_jitters);
+double deviation_jitters=jitters.GetStddev ()*1e3;
 NS_LOG_UNCOND("deviation jitters="<<deviation_jitters);
 
 NS_LOG_UNCOND("\n");
 NS_LOG_UNCOND("mean delay="<<mean_delay);
-NS_LOG_UNCOND("variance delay="<<variance_delay);
-double deviation_delay=sqrt(variance_delay);
+double deviation_delay=delays.GetStddev ()*1e3;
 NS_LOG_UNCOND("deviation delay="<<deviation_delay);
 
 
@@ -365,28 +410,65 @@ NS_LOG_UNCOND("Rate of Packets Lost="<<rate_packet_loss<<" packets per second");
 
 
 
-flowMonitor->SerializeToXmlFile("report1.xml", true, true);
-flowMonitor2->SerializeToXmlFile("report2.xml", true, true);
+if (!columnar)
+  {
+    flowMonitor->SerializeToXmlFile("report1.xml", true, true);
+    flowMonitor2->SerializeToXmlFile("report2.xml", true, true);
+  }
 
   Simulator::Destroy ();
 
   
-  // double averageThroughput = ((sink->GetTotalRx() * 8) / (1e6  * simulationTime));
-  // std::cout << "\nAverage throughtput: " << averageThroughput << " Mbit/s" << std::endl;
+  uint64_t totalRx = 0;
+  for (uint32_t i = 0; i < sinkApp.GetN (); ++i)
+    {
+      totalRx += DynamicCast<PacketSink> (sinkApp.Get (i))->GetTotalRx ();
+    }
+  double averageThroughput = ((totalRx * 8) / (1e6  * simulationTime));
+  std::cout << "\nAverage throughtput: " << averageThroughput << " Mbit/s" << std::endl;
+
+  uint32_t regressions = 0;
+  if (!benchmark.empty ())
+    {
+      report.AddKpi ("throughput", averageThroughput);
+      report.AddKpi ("lossPercent", percentage_loss);
+      report.AddKpi ("delayMean", mean_delay);
+      regressions = report.Finish (benchmark, recordBenchmark, std::cout);
+    }
 
+  if (columnar)
+    {
+      group.SetMeta ("percentage", percentage*100);
+      group.SetMeta ("run", RngSeedManager::GetRun ());
+      group.SetMeta ("throughput", averageThroughput);
+      group.SetMeta ("txPackets", sum_txpackets);
+      group.SetMeta ("rxPackets", sum_rxpackets);
+      group.SetMeta ("lossPercent", percentage_loss);
+      group.SetMeta ("lossRate", rate_packet_loss);
+      group.SetMeta ("delayMean", mean_delay);
+      group.SetMeta ("delayStd", deviation_delay);
+      group.SetMeta ("jitterMean", mean_jitters);
+      group.SetMeta ("jitterStd", deviation_jitters);
+      ResultsFile::Append (resultsFile, group.Serialize ());
+      return regressions > 0;
+    }
 
+  ofstream out;
+  out.open("report.csv");
 
-double to_div=1000000.0;
+  out<<"percentage,"<<"Aver. Throughput,"<<"Total packets sent,"<<"Total packets received,"<<"Traffic dropped(%),"<<"Traffic Dropped(Rate),"<<"Aver. delay,"<<"Delay Std. Dev,"<<"Aver. Jitters,"<<"Jitters Std. Dev\n";
+  out<<percentage*100<<",";
   out<<averageThroughput<<",";
   out<<sum_txpackets<<",";
   out<<sum_rxpackets<<",";
   out<<percentage_loss<<",";
   out<<rate_packet_loss<<",";
-  out<<mean_delay/to_div<<",";
-  out<<deviation_delay/to_div<<",";
-  out<<mean_jitters/to_div<<",";
-  out<<deviation_jitters/to_div<<",";
+  out<<mean_delay<<",";
+  out<<deviation_delay<<",";
+  out<<mean_jitters<<",";
+  out<<deviation_jitters<<",";
   out<<"\n";
+  out.close ();
 
 
 
@@ -401,5 +483,5 @@ double to_div=1000000.0;
 
 //   percentage+=0.05;
 // }
-  return 0;
+  return regressions > 0;
 }
@@ -39,6 +39,11 @@
 #include "ns3/ipv4-global-routing-helper.h"
 #include "ns3/internet-module.h"
 #include "ns3/gnuplot.h"
+#include "traffic-matrix.h"
+#include "benchmark-report.h"
+/* This program replaces operator new with the pool (packet-pool.h). */
+#define PACKET_POOL_REPLACE_NEW
+#include "packet-pool.h"
 #include <fstream>
 #include <vector>
 #include <cmath>
@@ -88,14 +93,30 @@ int main (int argc, char *argv[])
   double step = 5; //meters
   bool shortGuardInterval = false;
   bool channelBonding = false;
+  std::string trafficMatrix;                         /* Traffic matrix file, empty for all pairs. */
+  std::string benchmark;                             /* Benchmark bands file, empty for no benchmark. */
+  bool recordBenchmark = false;                      /* Write the bands file from this run instead of checking it. */
+  bool packetPool = true;                            /* Recycle packet allocations through free lists. */
 
   CommandLine cmd;
   cmd.AddValue ("step", "Granularity of the results to be plotted in meters", step);
   cmd.AddValue ("channelBonding", "Enable/disable channel bonding (channel width = 20 MHz if false, channel width = 40 MHz if true)", channelBonding);
   cmd.AddValue ("shortGuardInterval", "Enable/disable short guard interval", shortGuardInterval);
   cmd.AddValue ("frequency", "Whether working in the 2.4 or 5.0 GHz band (other values gets rejected)", frequency);
+  cmd.AddValue ("trafficMatrix", "Traffic matrix file, one \"src dst rateMbps\" per line (default: all pairs)", trafficMatrix);
+  cmd.AddValue ("benchmark", "Check the run against this bands file", benchmark);
+  cmd.AddValue ("recordBenchmark", "Write the --benchmark bands file from this run instead of checking it", recordBenchmark);
+  cmd.AddValue ("packetPool", "Recycle the packet, tag, event and callback allocations through per-thread free lists", packetPool);
   cmd.Parse (argc,argv);
 
+  PacketPool::Enable (packetPool);
+
+  BenchmarkReport report ("80211n-mimo");
+  if (!benchmark.empty ())
+    {
+      report.Start ();
+    }
+
 
   for (uint32_t i = 0; i < modes.size (); i++) //MCS
     {
@@ -197,25 +218,13 @@ int main (int argc, char *argv[])
           // sink = StaticCast<PacketSink> (sinkApp.Get(0));
 
           /* Install TCP/UDP Transmitter on the station */  
-          ApplicationContainer serverApp;
-          // srand(time(NULL));
-                  
-          for(int sender=0;sender<8;sender++)
-          {
-
-            double valself=0.65/56.0;
-            for(int rcv=0;rcv<8;rcv++)
-            {                
-                if(sender==rcv) continue;
-                OnOffHelper server ("ns3::TcpSocketFactory", (InetSocketAddress (staNodeInterface.GetAddress (rcv), 9)));
-                server.SetAttribute ("PacketSize", UintegerValue (payloadSize));
-                server.SetAttribute ("OnTime", StringValue ("ns3::ConstantRandomVariable[Constant=1]"));
-                server.SetAttribute ("OffTime", StringValue ("ns3::ConstantRandomVariable[Constant=0]"));
-                server.SetAttribute ("DataRate", DataRateValue (DataRate (std::to_string(valself)+"Mbps")));
-                serverApp.Add(server.Install(wifiStaNode.Get(sender)));    
-            }            
-          }
-
+          TrafficMatrix matrix = trafficMatrix.empty () ? TrafficMatrix::AllPairs (8, 0.65e6)
+                                                        : TrafficMatrix::Load (trafficMatrix, 8);
+          TrafficMatrixInstaller server ("ns3::TcpSocketFactory", 9);
+          server.SetAttribute ("PacketSize", UintegerValue (payloadSize));
+          server.SetAttribute ("OnTime", StringValue ("ns3::ConstantRandomVariable[Constant=1]"));
+          server.SetAttribute ("OffTime", StringValue ("ns3::ConstantRandomVariable[Constant=0]"));
+          ApplicationContainer serverApp = server.Install (matrix, wifiStaNode, staNodeInterface);
 
           sinkApp.Start (Seconds (0.0));
           sinkApp.Stop (Seconds (simulationTime + 1));
@@ -237,9 +246,16 @@ int main (int argc, char *argv[])
 
           throughput = totalPacketsThrough * 8 / (simulationTime * 1000000.0); //Mbit/s
           std::cout << throughput << " Mbit/s" <<std::endl;
+          std::ostringstream kpi;
+          kpi << "throughput-" << modes[i] << "-" << d << "m";
+          report.AddKpi (kpi.str (), throughput);
           d += step;
         }
     }
+  if (!benchmark.empty () && report.Finish (benchmark, recordBenchmark, std::cout) > 0)
+    {
+      return 1;
+    }
   return 0;
 }
 
@@ -0,0 +1,648 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef ASYNC_PCAP_WRITER_H
+#define ASYNC_PCAP_WRITER_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/wifi-module.h"
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief Pcap tracing with the file writes done by a background thread.
+ *
+ * The trace sinks run on the simulation thread and only copy the frame into
+ * a bounded single-producer/single-consumer ring buffer; a writer thread
+ * drains the ring into the pcap files.  When the ring is full the simulation
+ * thread waits for the writer rather than dropping frames, so the files are
+ * the same whatever the load; GetStalls () tells how often that happened.
+ *
+ * Frames are captured from the MonitorSnifferTx and MonitorSnifferRx traces
+ * of the WifiPhy, every frame a device sends and every frame it receives
+ * correctly, and written as DLT_IEEE802_11_RADIO with the radiotap header
+ * YansWifiPhyHelper builds from the same traces: TSFT, flags, rate,
+ * channel, antenna signal and noise on reception, the MCS fields of HT
+ * frames and the A-MPDU status of aggregated ones (VHT fields are left
+ * out).
+ *
+ * For contention studies the MAC headers are usually all that matters:
+ * SetSnapLength () truncates every record, radiotap header included (the
+ * record keeps its original length) and SetFrameTypes () drops whole frame types, both before the
+ * frame is copied.
+ *
+ * The payloads of the OnOff and bulk send applications are zeros that the
+ * Buffer of a packet keeps as a length only, its zero area.  The frame is
+ * read from Packet::Serialize, which keeps the zero area a length too, so
+ * the payload is never written out: the ring keeps the bytes before and
+ * after the zero area, and the writer thread writes the zeros from a
+ * static zero page.  A full-size data frame costs the ring and the writer
+ * its headers only.
+ *
+ * The writer thread starts with the first captured frame, so every
+ * EnableWifi () and every setting must come before Simulator::Run ().  It must also not be
+ * started before a SweepRunner forks: threads do not survive fork ().
+ */
+class AsyncPcapWriter
+{
+public:
+  /// Frame types for SetFrameTypes (), from the 802.11 frame control field.
+  enum FrameType
+  {
+    FRAME_DATA = 1,          //!< data and QoS data frames
+    FRAME_CONTROL = 2,       //!< RTS, CTS, ACK, block ack, ...
+    FRAME_BEACON = 4,        //!< beacons
+    FRAME_MANAGEMENT = 8,    //!< every other management frame
+    FRAME_ALL = 15
+  };
+
+  /// \param bufferSize bytes of the ring buffer between the two threads
+  AsyncPcapWriter (uint32_t bufferSize = 1 << 22);
+  /// Flushes and closes the files.
+  ~AsyncPcapWriter ();
+
+  /**
+   * Trace the devices into prefix-<node>-<device>.pcap, one file per device,
+   * named like YansWifiPhyHelper::EnablePcap names them.
+   */
+  void EnableWifi (std::string prefix, NetDeviceContainer devices);
+
+  /// \param snapLength bytes kept of each record, from 64 to 65535 (the default)
+  void SetSnapLength (uint32_t snapLength);
+  /// \param types the FrameType bits of the frames to keep; FRAME_ALL by default
+  void SetFrameTypes (uint32_t types);
+  /**
+   * \param types comma-separated frame types, among "data", "control",
+   *        "beacon", "management" and "all"
+   * \return the FrameType bits; aborts on an unknown name
+   */
+  static uint32_t ParseFrameTypes (std::string types);
+
+  /// Drain the ring, stop the writer thread and close the files.
+  void Close (void);
+
+  /// \return how many frames had to wait for room in the ring
+  uint64_t GetStalls (void) const;
+
+private:
+  /**
+   * Ring record header; the radiotap header and the frame follow, padded
+   * to 8 bytes, without the zeros bytes from zeroStart on, which are all 0.
+   */
+  struct Record
+  {
+    uint32_t file;
+    uint32_t capturedLength;
+    uint32_t length;
+    uint32_t zeroStart;
+    uint32_t zeros;
+    int64_t timeUs;
+  };
+
+  /// A frame as its Buffer holds it: head bytes, a zero area, tail bytes.
+  struct Layout
+  {
+    const uint8_t *head;
+    uint32_t headLength;
+    uint32_t zeros;
+    const uint8_t *tail;
+    uint32_t tailLength;
+  };
+
+  static const uint32_t WRAP = 0xffffffff;  //!< record file index marking a jump to the ring start
+  static const uint32_t DLT_IEEE802_11_RADIO = 127;
+  /// Room for the radiotap header and the MAC header of any frame.
+  static const uint32_t MIN_SNAP_LENGTH = 64;
+  static const uint32_t ZERO_PAGE = 4096;
+
+  uint32_t OpenFile (const std::string &path);
+  static uint32_t GetFrameType (Ptr<const Packet> packet);
+  static void SniffTx (AsyncPcapWriter *writer, uint32_t file, Ptr<const Packet> packet,
+                       uint16_t channelFreqMhz, uint16_t channelNumber, uint32_t rate,
+                       WifiPreamble preamble, WifiTxVector txVector, struct mpduInfo aMpdu);
+  static void SniffRx (AsyncPcapWriter *writer, uint32_t file, Ptr<const Packet> packet,
+                       uint16_t channelFreqMhz, uint16_t channelNumber, uint32_t rate,
+                       WifiPreamble preamble, WifiTxVector txVector, struct mpduInfo aMpdu,
+                       struct signalNoiseDbm signalNoise);
+  /// Build the radiotap header like YansWifiPhyHelper and enqueue the frame.
+  void Capture (uint32_t file, Ptr<const Packet> packet, uint16_t channelFreqMhz,
+                uint32_t rate, WifiPreamble preamble, WifiTxVector txVector,
+                struct mpduInfo aMpdu, const struct signalNoiseDbm *signalNoise);
+  void Enqueue (uint32_t file, Ptr<const Packet> packet, const RadiotapHeader &radiotap);
+  /// \return false when the serialized packet is not laid out as expected
+  bool FindZeroArea (Ptr<const Packet> packet, Layout &layout);
+  void Drain (void);
+
+  std::vector<uint8_t> m_ring;
+  std::atomic<uint64_t> m_head;     //!< bytes ever produced
+  std::atomic<uint64_t> m_tail;     //!< bytes ever consumed
+  std::atomic<bool> m_closing;
+  std::vector<FILE *> m_files;
+  std::thread m_thread;
+  bool m_started;
+  uint64_t m_stalls;
+  uint32_t m_snapLength;
+  uint32_t m_frameTypes;
+  std::vector<uint8_t> m_serialized;  //!< the last packet serialized by FindZeroArea ()
+};
+
+inline
+AsyncPcapWriter::AsyncPcapWriter (uint32_t bufferSize)
+  : m_ring ((bufferSize + 7) & ~7u),
+    m_head (0),
+    m_tail (0),
+    m_closing (false),
+    m_started (false),
+    m_stalls (0),
+    m_snapLength (65535),
+    m_frameTypes (FRAME_ALL)
+{
+  NS_ABORT_MSG_IF (m_ring.size () < 2 * sizeof (Record) + 65536, "AsyncPcapWriter: ring buffer too small");
+}
+
+inline
+AsyncPcapWriter::~AsyncPcapWriter ()
+{
+  Close ();
+}
+
+inline uint32_t
+AsyncPcapWriter::OpenFile (const std::string &path)
+{
+  NS_ABORT_MSG_IF (m_started, "AsyncPcapWriter: " << path << " enabled after the capture started");
+  FILE *file = std::fopen (path.c_str (), "wb");
+  NS_ABORT_MSG_IF (file == 0, "AsyncPcapWriter: cannot open " << path);
+  // Classic pcap global header: magic, version 2.4, GMT, accuracy, snaplen, link type.
+  uint32_t magic = 0xa1b2c3d4;
+  uint16_t major = 2;
+  uint16_t minor = 4;
+  int32_t zone = 0;
+  uint32_t sigfigs = 0;
+  uint32_t snaplen = m_snapLength;
+  uint32_t network = DLT_IEEE802_11_RADIO;
+  std::fwrite (&magic, sizeof (magic), 1, file);
+  std::fwrite (&major, sizeof (major), 1, file);
+  std::fwrite (&minor, sizeof (minor), 1, file);
+  std::fwrite (&zone, sizeof (zone), 1, file);
+  std::fwrite (&sigfigs, sizeof (sigfigs), 1, file);
+  std::fwrite (&snaplen, sizeof (snaplen), 1, file);
+  std::fwrite (&network, sizeof (network), 1, file);
+  m_files.push_back (file);
+  return m_files.size () - 1;
+}
+
+inline void
+AsyncPcapWriter::EnableWifi (std::string prefix, NetDeviceContainer devices)
+{
+  for (NetDeviceContainer::Iterator i = devices.Begin (); i != devices.End (); ++i)
+    {
+      Ptr<WifiNetDevice> device = DynamicCast<WifiNetDevice> (*i);
+      NS_ABORT_MSG_IF (device == 0, "AsyncPcapWriter: not a WifiNetDevice");
+      std::ostringstream path;
+      path << prefix << "-" << device->GetNode ()->GetId () << "-" << device->GetIfIndex () << ".pcap";
+      uint32_t file = OpenFile (path.str ());
+      Ptr<WifiPhy> phy = device->GetPhy ();
+      phy->TraceConnectWithoutContext ("MonitorSnifferTx", MakeBoundCallback (&AsyncPcapWriter::SniffTx, this, file));
+      phy->TraceConnectWithoutContext ("MonitorSnifferRx", MakeBoundCallback (&AsyncPcapWriter::SniffRx, this, file));
+    }
+}
+
+inline void
+AsyncPcapWriter::SetSnapLength (uint32_t snapLength)
+{
+  NS_ABORT_MSG_IF (!m_files.empty (), "AsyncPcapWriter: set the snap length before EnableWifi ()");
+  NS_ABORT_MSG_IF (snapLength < MIN_SNAP_LENGTH || snapLength > 65535, "AsyncPcapWriter: bad snap length " << snapLength);
+  m_snapLength = snapLength;
+}
+
+inline void
+AsyncPcapWriter::SetFrameTypes (uint32_t types)
+{
+  m_frameTypes = types;
+}
+
+inline uint32_t
+AsyncPcapWriter::ParseFrameTypes (std::string types)
+{
+  uint32_t bits = 0;
+  std::istringstream in (types);
+  std::string name;
+  while (std::getline (in, name, ','))
+    {
+      if (name == "data")
+        {
+          bits |= FRAME_DATA;
+        }
+      else if (name == "control")
+        {
+          bits |= FRAME_CONTROL;
+        }
+      else if (name == "beacon")
+        {
+          bits |= FRAME_BEACON;
+        }
+      else if (name == "management")
+        {
+          bits |= FRAME_MANAGEMENT;
+        }
+      else if (name == "all")
+        {
+          bits |= FRAME_ALL;
+        }
+      else
+        {
+          NS_ABORT_MSG ("AsyncPcapWriter: unknown frame type \"" << name << "\"");
+        }
+    }
+  return bits;
+}
+
+inline uint32_t
+AsyncPcapWriter::GetFrameType (Ptr<const Packet> packet)
+{
+  // Frame control, first byte: protocol version (2 bits), type (2), subtype (4).
+  uint8_t fc = 0;
+  packet->CopyData (&fc, 1);
+  switch ((fc >> 2) & 3)
+    {
+    case 0:
+      return ((fc >> 4) == 8) ? FRAME_BEACON : FRAME_MANAGEMENT;
+    case 1:
+      return FRAME_CONTROL;
+    case 2:
+      return FRAME_DATA;
+    default:
+      return 0;
+    }
+}
+
+inline void
+AsyncPcapWriter::SniffTx (AsyncPcapWriter *writer, uint32_t file, Ptr<const Packet> packet,
+                          uint16_t channelFreqMhz, uint16_t channelNumber, uint32_t rate,
+                          WifiPreamble preamble, WifiTxVector txVector, struct mpduInfo aMpdu)
+{
+  writer->Capture (file, packet, channelFreqMhz, rate, preamble, txVector, aMpdu, 0);
+}
+
+inline void
+AsyncPcapWriter::SniffRx (AsyncPcapWriter *writer, uint32_t file, Ptr<const Packet> packet,
+                          uint16_t channelFreqMhz, uint16_t channelNumber, uint32_t rate,
+                          WifiPreamble preamble, WifiTxVector txVector, struct mpduInfo aMpdu,
+                          struct signalNoiseDbm signalNoise)
+{
+  writer->Capture (file, packet, channelFreqMhz, rate, preamble, txVector, aMpdu, &signalNoise);
+}
+
+inline void
+AsyncPcapWriter::Capture (uint32_t file, Ptr<const Packet> packet, uint16_t channelFreqMhz,
+                          uint32_t rate, WifiPreamble preamble, WifiTxVector txVector,
+                          struct mpduInfo aMpdu, const struct signalNoiseDbm *signalNoise)
+{
+  RadiotapHeader header;
+  header.SetTsft (Simulator::Now ().GetMicroSeconds ());
+
+  // The capture includes the FCS.
+  uint8_t frameFlags = RadiotapHeader::FRAME_FLAG_FCS_INCLUDED;
+  if (preamble == WIFI_PREAMBLE_SHORT)
+    {
+      frameFlags |= RadiotapHeader::FRAME_FLAG_SHORT_PREAMBLE;
+    }
+  if (txVector.IsShortGuardInterval ())
+    {
+      frameFlags |= RadiotapHeader::FRAME_FLAG_SHORT_GUARD;
+    }
+  header.SetFrameFlags (frameFlags);
+  header.SetRate (rate);
+
+  uint16_t channelFlags = RadiotapHeader::CHANNEL_FLAG_NONE;
+  switch (rate)
+    {
+    case 2:  // 1 Mbit/s
+    case 4:  // 2 Mbit/s
+    case 10: // 5.5 Mbit/s
+    case 22: // 11 Mbit/s
+      channelFlags |= RadiotapHeader::CHANNEL_FLAG_CCK;
+      break;
+    default:
+      channelFlags |= RadiotapHeader::CHANNEL_FLAG_OFDM;
+      break;
+    }
+  channelFlags |= channelFreqMhz < 2500 ? RadiotapHeader::CHANNEL_FLAG_SPECTRUM_2GHZ
+                                        : RadiotapHeader::CHANNEL_FLAG_SPECTRUM_5GHZ;
+  header.SetChannelFrequencyAndFlags (channelFreqMhz, channelFlags);
+
+  if (signalNoise != 0)
+    {
+      header.SetAntennaSignalPower (signalNoise->signal);
+      header.SetAntennaNoisePower (signalNoise->noise);
+    }
+
+  if (preamble == WIFI_PREAMBLE_HT_MF || preamble == WIFI_PREAMBLE_HT_GF || preamble == WIFI_PREAMBLE_NONE)
+    {
+      uint8_t mcsKnown = RadiotapHeader::MCS_KNOWN_INDEX | RadiotapHeader::MCS_KNOWN_BANDWIDTH
+        | RadiotapHeader::MCS_KNOWN_GUARD_INTERVAL | RadiotapHeader::MCS_KNOWN_HT_FORMAT;
+      uint8_t mcsFlags = RadiotapHeader::MCS_FLAGS_NONE;
+      if (txVector.GetChannelWidth () == 40)
+        {
+          mcsFlags |= RadiotapHeader::MCS_FLAGS_BANDWIDTH_40;
+        }
+      if (txVector.IsShortGuardInterval ())
+        {
+          mcsFlags |= RadiotapHeader::MCS_FLAGS_GUARD_INTERVAL;
+        }
+      if (preamble == WIFI_PREAMBLE_HT_GF)
+        {
+          mcsFlags |= RadiotapHeader::MCS_FLAGS_HT_GREENFIELD;
+        }
+      // HT rates are reported as 128 + MCS index.
+      header.SetMcsFields (mcsKnown, mcsFlags, rate - 128);
+    }
+
+  if (aMpdu.type != NORMAL_MPDU)
+    {
+      // The MPDU delimiter is not part of the frame a monitor interface sees.
+      Ptr<Packet> mpdu = packet->Copy ();
+      AmpduSubframeHeader delimiter;
+      mpdu->RemoveHeader (delimiter);
+      uint16_t ampduFlags = RadiotapHeader::A_MPDU_STATUS_DELIMITER_CRC_KNOWN
+        | RadiotapHeader::A_MPDU_STATUS_LAST_KNOWN;
+      if (aMpdu.type == LAST_MPDU_IN_AGGREGATE)
+        {
+          ampduFlags |= RadiotapHeader::A_MPDU_STATUS_LAST;
+        }
+      header.SetAmpduStatus (aMpdu.mpduRefNumber, ampduFlags, delimiter.GetCrc ());
+      Enqueue (file, mpdu->CreateFragment (0, delimiter.GetLength ()), header);
+      return;
+    }
+  Enqueue (file, packet, header);
+}
+
+inline void
+AsyncPcapWriter::Enqueue (uint32_t file, Ptr<const Packet> packet, const RadiotapHeader &radiotap)
+{
+  if (m_frameTypes != FRAME_ALL && (GetFrameType (packet) & m_frameTypes) == 0)
+    {
+      return;
+    }
+  if (!m_started)
+    {
+      m_started = true;
+      m_thread = std::thread (&AsyncPcapWriter::Drain, this);
+    }
+
+  uint32_t radiotapLength = radiotap.GetSerializedSize ();
+  uint32_t length = radiotapLength + packet->GetSize ();
+  uint32_t captured = std::min (length, m_snapLength);
+
+  // Only the bytes around the zero area are stored, clipped to the captured
+  // length.  Should the serialized packet not parse, the frame is copied
+  // whole and its trailing zeros dropped instead.
+  Layout layout;
+  bool zeroArea = FindZeroArea (packet, layout);
+  uint32_t stored = captured;
+  if (zeroArea)
+    {
+      uint32_t room = captured - radiotapLength;
+      layout.headLength = std::min (layout.headLength, room);
+      room -= layout.headLength;
+      layout.zeros = std::min (layout.zeros, room);
+      layout.tailLength = room - layout.zeros;
+      // The tail is usually the FCS, which ns-3 leaves at zero.
+      if (uint32_t (std::count (layout.tail, layout.tail + layout.tailLength, 0)) == layout.tailLength)
+        {
+          layout.zeros += layout.tailLength;
+          layout.tailLength = 0;
+        }
+      stored = radiotapLength + layout.headLength + layout.tailLength;
+    }
+  uint64_t size = (sizeof (Record) + stored + 7) & ~7ull;
+  uint64_t ringSize = m_ring.size ();
+
+  // A record never wraps: if it does not fit before the end of the ring,
+  // the rest of the ring is skipped (with a WRAP marker when one fits).
+  uint64_t head = m_head.load (std::memory_order_relaxed);
+  uint64_t pos = head % ringSize;
+  uint64_t skip = (ringSize - pos < size) ? ringSize - pos : 0;
+
+  if (head + skip + size - m_tail.load (std::memory_order_acquire) > ringSize)
+    {
+      m_stalls++;
+      while (head + skip + size - m_tail.load (std::memory_order_acquire) > ringSize)
+        {
+          std::this_thread::yield ();
+        }
+    }
+
+  if (skip >= sizeof (Record))
+    {
+      Record marker;
+      marker.file = WRAP;
+      std::memcpy (&m_ring[pos], &marker, sizeof (marker));
+    }
+  pos = (head + skip) % ringSize;
+
+  uint8_t *data = &m_ring[pos + sizeof (Record)];
+  Buffer buffer;
+  buffer.AddAtStart (radiotapLength);
+  radiotap.Serialize (buffer.Begin ());
+  buffer.CopyData (data, radiotapLength);
+
+  Record record;
+  record.file = file;
+  record.capturedLength = captured;
+  record.length = length;
+  if (zeroArea)
+    {
+      std::memcpy (data + radiotapLength, layout.head, layout.headLength);
+      std::memcpy (data + radiotapLength + layout.headLength, layout.tail, layout.tailLength);
+      record.zeroStart = radiotapLength + layout.headLength;
+      record.zeros = layout.zeros;
+    }
+  else
+    {
+      packet->CopyData (data + radiotapLength, captured - radiotapLength);
+      while (stored > radiotapLength && data[stored - 1] == 0)
+        {
+          stored--;
+        }
+      record.zeroStart = stored;
+      record.zeros = captured - stored;
+    }
+  record.timeUs = Simulator::Now ().GetMicroSeconds ();
+  std::memcpy (&m_ring[pos], &record, sizeof (record));
+
+  m_head.store (head + skip + ((sizeof (Record) + stored + 7) & ~7ull), std::memory_order_release);
+}
+
+inline bool
+AsyncPcapWriter::FindZeroArea (Ptr<const Packet> packet, Layout &layout)
+{
+  uint32_t size = packet->GetSerializedSize ();
+  if (m_serialized.size () < size)
+    {
+      m_serialized.resize (size);
+    }
+  if (size == 0 || packet->Serialize (&m_serialized[0], size) == 0)
+    {
+      return false;
+    }
+  const uint8_t *data = &m_serialized[0];
+
+  // Packet::Serialize writes sections (nix-vector, tags, metadata, and
+  // the buffer last), each as its size plus 4, then its data padded to 4
+  // bytes.  The last section read is the buffer.
+  uint32_t offset = 0;
+  uint32_t bufferStart = 0;
+  uint32_t bufferSize = 0;
+  while (offset < size)
+    {
+      uint32_t sectionSize;
+      if (size - offset < 4)
+        {
+          return false;
+        }
+      std::memcpy (&sectionSize, data + offset, 4);
+      if (sectionSize < 4 || sectionSize - 4 > size - offset - 4)
+        {
+          return false;
+        }
+      bufferStart = offset + 4;
+      bufferSize = sectionSize - 4;
+      offset = bufferStart + ((bufferSize + 3) & ~3u);
+    }
+
+  // Buffer::Serialize writes the zero area size, then the length and the
+  // bytes before the zero area, then those after it, padded to 4 bytes.
+  const uint8_t *buffer = data + bufferStart;
+  if (bufferSize < 12)
+    {
+      return false;
+    }
+  std::memcpy (&layout.zeros, buffer, 4);
+  std::memcpy (&layout.headLength, buffer + 4, 4);
+  if (layout.headLength > bufferSize - 12)
+    {
+      return false;
+    }
+  uint32_t tailStart = 8 + ((layout.headLength + 3) & ~3u);
+  if (tailStart + 4 > bufferSize)
+    {
+      return false;
+    }
+  std::memcpy (&layout.tailLength, buffer + tailStart, 4);
+  if (layout.tailLength > bufferSize - tailStart - 4
+      || tailStart + 4 + ((layout.tailLength + 3) & ~3u) != bufferSize
+      || uint64_t (layout.headLength) + layout.zeros + layout.tailLength != packet->GetSize ())
+    {
+      return false;
+    }
+  layout.head = buffer + 8;
+  layout.tail = buffer + tailStart + 4;
+  return true;
+}
+
+inline void
+AsyncPcapWriter::Drain (void)
+{
+  static const uint8_t zeroPage[ZERO_PAGE] = { 0 };
+  uint64_t ringSize = m_ring.size ();
+  uint64_t tail = m_tail.load (std::memory_order_relaxed);
+  while (true)
+    {
+      uint64_t head = m_head.load (std::memory_order_acquire);
+      if (tail == head)
+        {
+          if (m_closing.load (std::memory_order_acquire) && tail == m_head.load (std::memory_order_acquire))
+            {
+              break;
+            }
+          std::this_thread::sleep_for (std::chrono::microseconds (100));
+          continue;
+        }
+      while (tail != head)
+        {
+          uint64_t pos = tail % ringSize;
+          if (ringSize - pos < sizeof (Record))
+            {
+              tail += ringSize - pos;
+              continue;
+            }
+          Record record;
+          std::memcpy (&record, &m_ring[pos], sizeof (record));
+          if (record.file == WRAP)
+            {
+              tail += ringSize - pos;
+              continue;
+            }
+          uint32_t header[4];
+          header[0] = record.timeUs / 1000000;
+          header[1] = record.timeUs % 1000000;
+          header[2] = record.capturedLength;
+          header[3] = record.length;
+          FILE *file = m_files[record.file];
+          std::fwrite (header, sizeof (header), 1, file);
+          uint32_t stored = record.capturedLength - record.zeros;
+          const uint8_t *data = &m_ring[pos + sizeof (record)];
+          std::fwrite (data, 1, record.zeroStart, file);
+          for (uint32_t zeros = record.zeros; zeros > 0; )
+            {
+              uint32_t chunk = zeros < ZERO_PAGE ? zeros : ZERO_PAGE;
+              std::fwrite (zeroPage, 1, chunk, file);
+              zeros -= chunk;
+            }
+          std::fwrite (data + record.zeroStart, 1, stored - record.zeroStart, file);
+          tail += (sizeof (Record) + stored + 7) & ~7ull;
+        }
+      m_tail.store (tail, std::memory_order_release);
+    }
+}
+
+inline void
+AsyncPcapWriter::Close (void)
+{
+  if (m_started)
+    {
+      m_closing.store (true, std::memory_order_release);
+      m_thread.join ();
+      m_started = false;
+    }
+  for (std::vector<FILE *>::iterator i = m_files.begin (); i != m_files.end (); ++i)
+    {
+      std::fclose (*i);
+    }
+  m_files.clear ();
+}
+
+inline uint64_t
+AsyncPcapWriter::GetStalls (void) const
+{
+  return m_stalls;
+}
+
+} // namespace ns3
+
+#endif /* ASYNC_PCAP_WRITER_H */
@@ -0,0 +1,474 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef BENCHMARK_REPORT_H
+#define BENCHMARK_REPORT_H
+
+#include "ns3/core-module.h"
+#include "ns3/map-scheduler.h"
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+
+namespace ns3 {
+
+/**
+ * \brief Expected range of every benchmark metric of a scenario.
+ *
+ * The text form has one metric per line, "name min max", with '#' starting
+ * a comment; "inf" and "-inf" leave a side open.
+ */
+class BenchmarkBands
+{
+public:
+  /// Read the bands; aborts on a malformed file.
+  static BenchmarkBands Load (const std::string &path);
+  /// Write the bands in text form.
+  void Save (const std::string &path) const;
+
+  /// Set the range of a metric.
+  void Set (const std::string &name, double min, double max);
+  bool Has (const std::string &name) const;
+  double GetMin (const std::string &name) const;
+  double GetMax (const std::string &name) const;
+  /// \return the names of the metrics, in name order
+  std::vector<std::string> GetNames (void) const;
+
+private:
+  std::map<std::string, std::pair<double, double> > m_bands;
+};
+
+/**
+ * \brief Counts the events handed out by another scheduler.
+ *
+ * The events are ordered by the scheduler of the Inner attribute (the
+ * MapScheduler by default), so counting works whatever the queue.
+ *
+ * The counters live in memory shared with every process forked after
+ * GetEventCount () is first called, one cache line per process slot, so a
+ * count taken in the parent includes the events of its SweepRunner workers.
+ */
+class CountingScheduler : public Scheduler
+{
+public:
+  static TypeId GetTypeId (void);
+
+  virtual void Insert (const Scheduler::Event &ev);
+  virtual bool IsEmpty (void) const;
+  virtual Scheduler::Event PeekNext (void) const;
+  virtual Scheduler::Event RemoveNext (void);
+  virtual void Remove (const Scheduler::Event &ev);
+
+  /// \return the events removed by this process and the workers it forked
+  static uint64_t GetEventCount (void);
+
+protected:
+  virtual void NotifyConstructionCompleted (void);
+
+private:
+  static const uint32_t N_SLOTS = 64;
+  struct Slot
+  {
+    std::atomic<uint64_t> events;
+    char padding[64 - sizeof (std::atomic<uint64_t>)];
+  };
+  static Slot * GetSlots (void);
+
+  TypeId m_innerType;
+  Ptr<Scheduler> m_inner;
+};
+
+/**
+ * \brief Simulator and model performance of one scenario run, checked
+ * against the scenario's bands.
+ *
+ * Start () switches the simulator to the CountingScheduler and starts the
+ * wall clock; the scenario then adds its KPIs (throughputs, delays, ...)
+ * and Finish () adds the performance metrics:
+ *
+ *  - wallClock: elapsed seconds since Start ()
+ *  - events: simulator events executed, workers included
+ *  - eventsPerSecond: events per wall-clock second
+ *  - peakRssMb: largest resident set of the process or any worker, in MiB
+ *
+ * Every metric is compared with its band and one outside it is a
+ * regression; bands of metrics the run did not produce (another transport,
+ * fewer load points) are listed as missing.  The results are printed and
+ * appended to benchmark.csv so runs can be compared over time.
+ *
+ * A missing bands file is a failure, so that a wrong path cannot pass.
+ * Recording is explicit: with record set, Finish () writes the bands from
+ * this run instead of checking them.  The KPIs and the event count get a
+ * band of +/- the KPI tolerance and the other performance metrics an open
+ * band on their good side, the perf tolerance away on the other.
+ */
+class BenchmarkReport
+{
+public:
+  /// \param scenario name of the scenario, as written to benchmark.csv
+  BenchmarkReport (std::string scenario);
+
+  /// Install the counting scheduler and start the wall clock; call it
+  /// before the first use of the simulator.
+  void Start (void);
+
+  /// Add a model metric.
+  void AddKpi (std::string name, double value);
+
+  /**
+   * \param kpi relative half-width of recorded KPI bands (default 0.05)
+   * \param perf relative slack of recorded performance bands (default 0.5)
+   */
+  void SetTolerance (double kpi, double perf);
+
+  /**
+   * Measure, check and print.
+   *
+   * \param bandsPath the scenario's bands file
+   * \param record write the bands file from this run instead of checking it
+   * \param os where the table goes
+   * \return the number of regressions, 1 when the bands file is missing
+   */
+  uint32_t Finish (std::string bandsPath, bool record, std::ostream &os);
+
+private:
+  static double GetPeakRssMb (void);
+
+  std::string m_scenario;
+  std::vector<std::pair<std::string, double> > m_metrics;
+  double m_kpiTolerance;
+  double m_perfTolerance;
+  struct timeval m_start;
+  uint64_t m_startEvents;
+};
+
+inline BenchmarkBands
+BenchmarkBands::Load (const std::string &path)
+{
+  std::ifstream in (path.c_str ());
+  NS_ABORT_MSG_IF (!in, "BenchmarkBands: cannot open " << path);
+  BenchmarkBands bands;
+  std::string line;
+  uint32_t lineNo = 0;
+  while (std::getline (in, line))
+    {
+      ++lineNo;
+      line = line.substr (0, line.find ('#'));
+      std::istringstream fields (line);
+      std::string name, min, max;
+      if (!(fields >> name))
+        {
+          continue;
+        }
+      NS_ABORT_MSG_IF (!(fields >> min >> max), path << ":" << lineNo << ": expected \"name min max\"");
+      bands.Set (name, std::strtod (min.c_str (), 0), std::strtod (max.c_str (), 0));
+    }
+  return bands;
+}
+
+inline void
+BenchmarkBands::Save (const std::string &path) const
+{
+  std::ofstream out (path.c_str ());
+  out << "# name min max\n";
+  out.precision (6);
+  for (std::map<std::string, std::pair<double, double> >::const_iterator i = m_bands.begin (); i != m_bands.end (); ++i)
+    {
+      out << i->first << " " << i->second.first << " " << i->second.second << "\n";
+    }
+}
+
+inline void
+BenchmarkBands::Set (const std::string &name, double min, double max)
+{
+  m_bands[name] = std::make_pair (min, max);
+}
+
+inline bool
+BenchmarkBands::Has (const std::string &name) const
+{
+  return m_bands.find (name) != m_bands.end ();
+}
+
+inline double
+BenchmarkBands::GetMin (const std::string &name) const
+{
+  return m_bands.find (name)->second.first;
+}
+
+inline double
+BenchmarkBands::GetMax (const std::string &name) const
+{
+  return m_bands.find (name)->second.second;
+}
+
+inline std::vector<std::string>
+BenchmarkBands::GetNames (void) const
+{
+  std::vector<std::string> names;
+  for (std::map<std::string, std::pair<double, double> >::const_iterator i = m_bands.begin (); i != m_bands.end (); ++i)
+    {
+      names.push_back (i->first);
+    }
+  return names;
+}
+
+NS_OBJECT_ENSURE_REGISTERED (CountingScheduler);
+
+inline TypeId
+CountingScheduler::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::CountingScheduler")
+    .SetParent<Scheduler> ()
+    .SetGroupName ("Core")
+    .AddConstructor<CountingScheduler> ()
+    .AddAttribute ("Inner", "The scheduler that orders the events.",
+                   TypeIdValue (MapScheduler::GetTypeId ()),
+                   MakeTypeIdAccessor (&CountingScheduler::m_innerType),
+                   MakeTypeIdChecker ())
+  ;
+  return tid;
+}
+
+inline void
+CountingScheduler::NotifyConstructionCompleted (void)
+{
+  Scheduler::NotifyConstructionCompleted ();
+  ObjectFactory factory;
+  factory.SetTypeId (m_innerType);
+  m_inner = factory.Create<Scheduler> ();
+}
+
+inline void
+CountingScheduler::Insert (const Scheduler::Event &ev)
+{
+  m_inner->Insert (ev);
+}
+
+inline bool
+CountingScheduler::IsEmpty (void) const
+{
+  return m_inner->IsEmpty ();
+}
+
+inline Scheduler::Event
+CountingScheduler::PeekNext (void) const
+{
+  return m_inner->PeekNext ();
+}
+
+inline void
+CountingScheduler::Remove (const Scheduler::Event &ev)
+{
+  m_inner->Remove (ev);
+}
+
+inline CountingScheduler::Slot *
+CountingScheduler::GetSlots (void)
+{
+  static Slot *slots = 0;
+  if (slots == 0)
+    {
+      void *memory = mmap (0, N_SLOTS * sizeof (Slot), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+      NS_ABORT_MSG_IF (memory == MAP_FAILED, "CountingScheduler: cannot map the counters");
+      slots = static_cast<Slot *> (memory);
+    }
+  return slots;
+}
+
+inline Scheduler::Event
+CountingScheduler::RemoveNext (void)
+{
+  static Slot *slot = 0;
+  static pid_t owner = 0;
+  // Workers inherit the parent's slot pointer; move to their own slot.
+  if (owner != getpid ())
+    {
+      owner = getpid ();
+      slot = &GetSlots ()[owner % N_SLOTS];
+    }
+  slot->events.fetch_add (1, std::memory_order_relaxed);
+  return m_inner->RemoveNext ();
+}
+
+inline uint64_t
+CountingScheduler::GetEventCount (void)
+{
+  Slot *slots = GetSlots ();
+  uint64_t events = 0;
+  for (uint32_t i = 0; i < N_SLOTS; ++i)
+    {
+      events += slots[i].events.load (std::memory_order_relaxed);
+    }
+  return events;
+}
+
+inline
+BenchmarkReport::BenchmarkReport (std::string scenario)
+  : m_scenario (scenario),
+    m_kpiTolerance (0.05),
+    m_perfTolerance (0.5),
+    m_startEvents (0)
+{
+  gettimeofday (&m_start, 0);
+}
+
+inline void
+BenchmarkReport::Start (void)
+{
+  // The global value survives the Simulator::Destroy () between runs.
+  GlobalValue::Bind ("SchedulerType", StringValue ("ns3::CountingScheduler"));
+  ObjectFactory factory;
+  factory.SetTypeId ("ns3::CountingScheduler");
+  Simulator::SetScheduler (factory);
+  m_startEvents = CountingScheduler::GetEventCount ();
+  gettimeofday (&m_start, 0);
+}
+
+inline void
+BenchmarkReport::AddKpi (std::string name, double value)
+{
+  m_metrics.push_back (std::make_pair (name, value));
+}
+
+inline void
+BenchmarkReport::SetTolerance (double kpi, double perf)
+{
+  m_kpiTolerance = kpi;
+  m_perfTolerance = perf;
+}
+
+inline double
+BenchmarkReport::GetPeakRssMb (void)
+{
+  // ru_maxrss is in KiB; the children figure is the largest waited-for worker.
+  struct rusage self, children;
+  getrusage (RUSAGE_SELF, &self);
+  getrusage (RUSAGE_CHILDREN, &children);
+  return std::max (self.ru_maxrss, children.ru_maxrss) / 1024.0;
+}
+
+inline uint32_t
+BenchmarkReport::Finish (std::string bandsPath, bool record, std::ostream &os)
+{
+  struct timeval now;
+  gettimeofday (&now, 0);
+  double wallClock = (now.tv_sec - m_start.tv_sec) + (now.tv_usec - m_start.tv_usec) / 1e6;
+  uint64_t events = CountingScheduler::GetEventCount () - m_startEvents;
+  uint32_t nKpis = m_metrics.size ();
+  m_metrics.push_back (std::make_pair ("wallClock", wallClock));
+  m_metrics.push_back (std::make_pair ("events", (double) events));
+  m_metrics.push_back (std::make_pair ("eventsPerSecond", wallClock > 0 ? events / wallClock : 0.0));
+  m_metrics.push_back (std::make_pair ("peakRssMb", GetPeakRssMb ()));
+
+  double inf = std::numeric_limits<double>::infinity ();
+  BenchmarkBands bands;
+  if (record)
+    {
+      for (uint32_t i = 0; i < m_metrics.size (); ++i)
+        {
+          const std::string &name = m_metrics[i].first;
+          double value = m_metrics[i].second;
+          if (i < nKpis)
+            {
+              double slack = std::fabs (value) * m_kpiTolerance;
+              bands.Set (name, value - slack, value + slack);
+            }
+          else if (name == "eventsPerSecond")
+            {
+              bands.Set (name, value * (1 - m_perfTolerance), inf);
+            }
+          else if (name == "events")
+            {
+              // The event count is deterministic for a given model; it only
+              // changes when the model does.
+              bands.Set (name, value * (1 - m_kpiTolerance), value * (1 + m_kpiTolerance));
+            }
+          else
+            {
+              bands.Set (name, -inf, value * (1 + m_perfTolerance));
+            }
+        }
+      bands.Save (bandsPath);
+      os << "Recorded benchmark bands of " << m_scenario << " in " << bandsPath << std::endl;
+    }
+  else if (!std::ifstream (bandsPath.c_str ()))
+    {
+      os << "No benchmark bands of " << m_scenario << " in " << bandsPath
+         << "; record them with --recordBenchmark" << std::endl;
+      std::ofstream log ("benchmark.csv", std::ios::app);
+      log << m_scenario << ",bands,,MISSING\n";
+      return 1;
+    }
+  else
+    {
+      bands = BenchmarkBands::Load (bandsPath);
+    }
+
+  std::ofstream log ("benchmark.csv", std::ios::app);
+  uint32_t regressions = 0;
+  std::map<std::string, bool> seen;
+  os << std::left << std::setw (32) << "metric" << std::setw (16) << "value"
+     << std::setw (16) << "min" << std::setw (16) << "max" << "status" << std::endl;
+  for (uint32_t i = 0; i < m_metrics.size (); ++i)
+    {
+      const std::string &name = m_metrics[i].first;
+      double value = m_metrics[i].second;
+      seen[name] = true;
+      std::string status = "-";
+      std::ostringstream min, max;
+      if (bands.Has (name))
+        {
+          min << bands.GetMin (name);
+          max << bands.GetMax (name);
+          status = (value < bands.GetMin (name) || value > bands.GetMax (name)) ? "REGRESSION" : "ok";
+          regressions += (status == "REGRESSION");
+        }
+      os << std::setw (32) << name << std::setw (16) << value << std::setw (16) << min.str ()
+         << std::setw (16) << max.str () << status << std::endl;
+      log << m_scenario << "," << name << "," << value << "," << status << "\n";
+    }
+  std::vector<std::string> names = bands.GetNames ();
+  for (uint32_t i = 0; i < names.size (); ++i)
+    {
+      if (!seen[names[i]])
+        {
+          os << std::setw (32) << names[i] << std::setw (16) << "" << std::setw (16) << bands.GetMin (names[i])
+             << std::setw (16) << bands.GetMax (names[i]) << "MISSING" << std::endl;
+          log << m_scenario << "," << names[i] << ",,MISSING\n";
+        }
+    }
+  os << std::right;
+  return regressions;
+}
+
+} // namespace ns3
+
+#endif /* BENCHMARK_REPORT_H */
@@ -0,0 +1,80 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * Runs every benchmarked scenario against its bands file (see
+ * benchmark-report.h) and exits non-zero if any of them regressed, in
+ * simulator performance or in modeled throughput.
+ *
+ * The scenarios run one after the other so that their wall-clock times do
+ * not disturb each other.  A scenario without a bands file fails; --record
+ * writes every bands file from this run instead, to be committed as the
+ * new baseline once checked.
+ *
+ *   ./waf build
+ *   ./waf --run benchmark-suite
+ *   ./waf --run "benchmark-suite --scenarios=80211b,wifi-singleap"
+ *   ./waf --run "benchmark-suite --record"
+ */
+
+#include "ns3/core-module.h"
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+
+using namespace ns3;
+
+int
+main (int argc, char *argv[])
+{
+  std::string scenarios = "80211b,80211n-mimo,wifi-singleap,wifi-wired-bridging,mixed-bg-network,wifi-tcp";
+  std::string binDir = "build/scratch";
+  std::string bandsDir = "scratch";
+  bool record = false;
+
+  CommandLine cmd;
+  cmd.AddValue ("scenarios", "Comma-separated scenarios to run", scenarios);
+  cmd.AddValue ("binDir", "Directory of the built scenario programs", binDir);
+  cmd.AddValue ("bandsDir", "Directory of the <scenario>.bands files", bandsDir);
+  cmd.AddValue ("record", "Record the bands files from this run instead of checking them", record);
+  cmd.Parse (argc, argv);
+
+  std::vector<std::string> names;
+  std::vector<int> status;
+  std::istringstream in (scenarios);
+  std::string name;
+  while (std::getline (in, name, ','))
+    {
+      std::string command = binDir + "/" + name + " --benchmark=" + bandsDir + "/" + name + ".bands"
+        + (record ? " --recordBenchmark=1" : "");
+      std::cout << "=== " << name << std::endl;
+      int result = std::system (command.c_str ());
+      names.push_back (name);
+      status.push_back (WIFEXITED (result) ? WEXITSTATUS (result) : -1);
+    }
+
+  uint32_t failed = 0;
+  std::cout << std::endl << "scenario\tresult" << std::endl;
+  for (uint32_t i = 0; i < names.size (); ++i)
+    {
+      std::cout << names[i] << "\t" << (status[i] == 0 ? "ok" : "REGRESSION") << std::endl;
+      failed += (status[i] != 0);
+    }
+  return failed > 0;
+}
@@ -0,0 +1,224 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef CACHED_LOSS_MODEL_H
+#define CACHED_LOSS_MODEL_H
+
+#include "ns3/core-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/propagation-module.h"
+#include "ns3/wifi-module.h"
+#include <stdint.h>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <unordered_map>
+
+namespace ns3 {
+
+/**
+ * \brief Remembers the received power computed by another propagation loss
+ * model for every (sender, receiver, transmit power).
+ *
+ * In a static topology the log-distance and Friis models give the same
+ * answer for every frame a node sends, yet YansWifiChannel asks again, with
+ * a log10 and a square root, for every frame and receiver.  This model asks
+ * its Inner model once per pair and transmit power and answers from a hash
+ * table afterwards; the cache is emptied whenever one of the mobility models
+ * it has seen reports a course change, so moving nodes stay correct and only
+ * lose the benefit.
+ *
+ * The inner model must be deterministic: a fading model would be frozen at
+ * its first draw.  Install () puts the cache in front of a channel's model.
+ */
+class CachedPropagationLossModel : public PropagationLossModel
+{
+public:
+  static TypeId GetTypeId (void);
+
+  CachedPropagationLossModel ();
+
+  /// Cache the propagation loss model of channel.
+  static Ptr<CachedPropagationLossModel> Install (Ptr<YansWifiChannel> channel);
+
+  void SetInner (Ptr<PropagationLossModel> inner);
+  Ptr<PropagationLossModel> GetInner (void) const;
+
+  uint64_t GetHits (void) const;
+  uint64_t GetMisses (void) const;
+
+private:
+  struct Key
+  {
+    const MobilityModel *a;
+    const MobilityModel *b;
+    bool operator== (const Key &other) const
+    {
+      return a == other.a && b == other.b;
+    }
+  };
+  struct KeyHash
+  {
+    std::size_t operator() (const Key &key) const
+    {
+      return std::hash<const void *> () (key.a) * 31 + std::hash<const void *> () (key.b);
+    }
+  };
+  /// One transmit power per pair: nodes rarely change it.
+  struct Entry
+  {
+    double txPowerDbm;
+    double rxPowerDbm;
+  };
+
+  virtual double DoCalcRxPower (double txPowerDbm, Ptr<MobilityModel> a, Ptr<MobilityModel> b) const;
+  virtual int64_t DoAssignStreams (int64_t stream);
+  virtual void DoDispose (void);
+
+  void Watch (Ptr<MobilityModel> model) const;
+  void CourseChanged (Ptr<const MobilityModel> model);
+
+  Ptr<PropagationLossModel> m_inner;
+  mutable std::unordered_map<Key, Entry, KeyHash> m_cache;
+  /**
+   * The mobility models whose course changes are watched.  Holding them
+   * also keeps their addresses, the cache keys, from being reused.
+   */
+  mutable std::map<const MobilityModel *, Ptr<MobilityModel> > m_watched;
+  mutable uint64_t m_hits;
+  mutable uint64_t m_misses;
+};
+
+NS_OBJECT_ENSURE_REGISTERED (CachedPropagationLossModel);
+
+inline TypeId
+CachedPropagationLossModel::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::CachedPropagationLossModel")
+    .SetParent<PropagationLossModel> ()
+    .SetGroupName ("Propagation")
+    .AddConstructor<CachedPropagationLossModel> ()
+    .AddAttribute ("Inner", "The propagation loss model whose results are cached.",
+                   PointerValue (),
+                   MakePointerAccessor (&CachedPropagationLossModel::m_inner),
+                   MakePointerChecker<PropagationLossModel> ())
+  ;
+  return tid;
+}
+
+inline
+CachedPropagationLossModel::CachedPropagationLossModel ()
+  : m_hits (0),
+    m_misses (0)
+{
+}
+
+inline Ptr<CachedPropagationLossModel>
+CachedPropagationLossModel::Install (Ptr<YansWifiChannel> channel)
+{
+  PointerValue loss;
+  channel->GetAttribute ("PropagationLossModel", loss);
+  NS_ABORT_MSG_IF (loss.Get<PropagationLossModel> () == 0, "The channel has no propagation loss model");
+  Ptr<CachedPropagationLossModel> cache = CreateObject<CachedPropagationLossModel> ();
+  cache->SetInner (loss.Get<PropagationLossModel> ());
+  channel->SetPropagationLossModel (cache);
+  return cache;
+}
+
+inline void
+CachedPropagationLossModel::SetInner (Ptr<PropagationLossModel> inner)
+{
+  m_inner = inner;
+  m_cache.clear ();
+}
+
+inline Ptr<PropagationLossModel>
+CachedPropagationLossModel::GetInner (void) const
+{
+  return m_inner;
+}
+
+inline uint64_t
+CachedPropagationLossModel::GetHits (void) const
+{
+  return m_hits;
+}
+
+inline uint64_t
+CachedPropagationLossModel::GetMisses (void) const
+{
+  return m_misses;
+}
+
+inline void
+CachedPropagationLossModel::Watch (Ptr<MobilityModel> model) const
+{
+  if (m_watched.insert (std::make_pair (PeekPointer (model), model)).second)
+    {
+      model->TraceConnectWithoutContext ("CourseChange",
+                                         MakeCallback (&CachedPropagationLossModel::CourseChanged,
+                                                       const_cast<CachedPropagationLossModel *> (this)));
+    }
+}
+
+inline void
+CachedPropagationLossModel::CourseChanged (Ptr<const MobilityModel> model)
+{
+  m_cache.clear ();
+}
+
+inline double
+CachedPropagationLossModel::DoCalcRxPower (double txPowerDbm, Ptr<MobilityModel> a, Ptr<MobilityModel> b) const
+{
+  NS_ASSERT (m_inner != 0);
+  Key key = { PeekPointer (a), PeekPointer (b) };
+  std::unordered_map<Key, Entry, KeyHash>::iterator found = m_cache.find (key);
+  if (found != m_cache.end () && found->second.txPowerDbm == txPowerDbm)
+    {
+      m_hits++;
+      return found->second.rxPowerDbm;
+    }
+  m_misses++;
+  Watch (a);
+  Watch (b);
+  Entry entry = { txPowerDbm, m_inner->CalcRxPower (txPowerDbm, a, b) };
+  m_cache[key] = entry;
+  return entry.rxPowerDbm;
+}
+
+inline int64_t
+CachedPropagationLossModel::DoAssignStreams (int64_t stream)
+{
+  return m_inner == 0 ? 0 : m_inner->AssignStreams (stream);
+}
+
+inline void
+CachedPropagationLossModel::DoDispose (void)
+{
+  for (std::map<const MobilityModel *, Ptr<MobilityModel> >::iterator i = m_watched.begin (); i != m_watched.end (); ++i)
+    {
+      i->second->TraceDisconnectWithoutContext ("CourseChange",
+                                                MakeCallback (&CachedPropagationLossModel::CourseChanged, this));
+    }
+  m_cache.clear ();
+  m_watched.clear ();
+  m_inner = 0;
+  PropagationLossModel::DoDispose ();
+}
+
+} // namespace ns3
+
+#endif /* CACHED_LOSS_MODEL_H */
@@ -42,6 +42,19 @@
 #include "ns3/flow-monitor-module.h"
 #include<iostream>
 #include<fstream>
+#include<sstream>
+#include "sweep-runner.h"
+#include "knee-search.h"
+#include "steady-state-detector.h"
+#include "sample-stats.h"
+#include "flow-stats-collector.h"
+#include "results-store.h"
+#include "scenario-template.h"
+#include "throughput-sampler.h"
+#include "async-pcap-writer.h"
+#include "grid-channel-index.h"
+#include "cached-loss-model.h"
+#include "table-error-rate-model.h"
 
 NS_LOG_COMPONENT_DEFINE ("wifi-tcp-b");
 
@@ -49,82 +62,72 @@ using namespace ns3;
 using std::ofstream;
 
 Ptr<PacketSink> sink;                         /* Pointer to the packet sink application */
-uint64_t lastTotalRx = 0;                     /* The value of the last total received bytes */
 
-void
-CalculateThroughput ()
-{
-  Time now = Simulator::Now ();                                         /* Return the simulator's virtual time. */
-  double cur = (sink->GetTotalRx() - lastTotalRx) * (double) 8/1e5;     /* Convert Application RX Packets to MBits. */
-  std::cout << now.GetSeconds () << "s: \t" << cur << " Mbit/s" << std::endl;
-  lastTotalRx = sink->GetTotalRx ();
-  Simulator::Schedule (MilliSeconds (100), &CalculateThroughput);
-}
+uint32_t payloadSize = 1472;                       /* Transport layer payload size in bytes. */
+std::string dataRate = "1Mbps";                  /* Application layer datarate. */
+std::string tcpVariant = "ns3::TcpNewReno";        /* TCP variant type. */
+std::string phyRate = "HtMcs7";                    /* Physical layer bitrate. */
+double simulationTime = 10;                        /* Simulation time in seconds. */
+bool pcapTracing = true;                          /* PCAP Tracing is enabled or not. */
+uint32_t pcapSnapLen = 65535;                      /* Bytes captured per frame; 64 keeps the MAC header. */
+std::string pcapFrames = "all";                    /* Frame types captured: data,control,beacon,management. */
+double minLoad = 0.10;                             /* First offered load point, as a fraction of 11 Mbps. */
+double maxLoad = 0.90;                             /* Last offered load point. */
+double loadStep = 0.05;                            /* Distance between load points. */
+bool adaptive = false;                             /* Bisect to the saturation knee instead of running every point. */
+std::vector<uint32_t> loadPoints;                  /* Grid point of each job of the current sweep. */
+uint32_t replications = 1;                         /* Independent runs per load point. */
+uint32_t firstRun = 1;                             /* RngRun of the first replica. */
+std::string output = "csv";                        /* csv: report.csv and FlowMonitor XML, columnar: resultsFile. */
+std::string resultsFile = "report.wres";           /* Columnar results file, one row group per job. */
+ScenarioTemplate scenario;                         /* The BSS every load point runs on. */
+bool warmupFork = true;                            /* Fork the load points after the 1 s warm-up. */
+uint32_t sampleInterval = 100;                     /* Throughput sampling period in ms, 0 disables it. */
+bool lossCache = true;                             /* Cache the path loss of the static node pairs. */
+bool errorTables = true;                           /* Error rates from precomputed SNR tables. */
+bool gridChannel = false;                          /* Send only to the PHYs in range (grid-channel-index.h). */
+bool steadyState = false;                          /* Stop a run once its metrics have converged. */
+double ciTarget = 0.05;                            /* Relative confidence half width that counts as converged. */
+double minTime = 1;                                /* Seconds a steady-state run lasts at least. */
 
-int
-main(int argc, char *argv[])
+/*
+ * Builds the load-independent part of the scenario: one 802.11b AP and eight
+ * stations with their Internet stacks and addresses. It runs once per
+ * replication, in the parent, and every load point starts from its result.
+ */
+void
+BuildBss (BssTopology &bss)
 {
-
-  ofstream out;
-  out.open("report.csv");
-  
-  out<<"percentage,"<<"Aver. Throughput,"<<"Total packets sent,"<<"Total packets received,"<<"Traffic dropped(%),"<<"Traffic Dropped(Rate),"<<"Aver. delay,"<<"Delay Std. Dev,"<<"Aver. Jitters,"<<"Jitters Std. Dev\n";
-
-
-  double percentage=0.10;
-  while(percentage<=0.90)
-  {
-
-    out<<percentage*100<<",";
-
-  uint32_t payloadSize = 1472;                       /* Transport layer payload size in bytes. */
-  std::string dataRate = "1Mbps";                  /* Application layer datarate. */
-  std::string tcpVariant = "ns3::TcpNewReno";        /* TCP variant type. */
-  std::string phyRate = "HtMcs7";                    /* Physical layer bitrate. */
-  double simulationTime = 10;                        /* Simulation time in seconds. */
-  bool pcapTracing = true;                          /* PCAP Tracing is enabled or not. */
-
-
-  /* Command line argument parser setup. */
-  CommandLine cmd;
-  cmd.AddValue ("payloadSize", "Payload size in bytes", payloadSize);
-  cmd.AddValue ("dataRate", "Application data ate", dataRate);
-  cmd.AddValue ("tcpVariant", "Transport protocol to use: TcpTahoe, TcpReno, TcpNewReno, TcpWestwood, TcpWestwoodPlus ", tcpVariant);
-  cmd.AddValue ("phyRate", "Physical layer bitrate", phyRate);
-  cmd.AddValue ("simulationTime", "Simulation time in seconds", simulationTime);
-  cmd.AddValue ("pcap", "Enable/disable PCAP Tracing", pcapTracing);
-  cmd.Parse (argc, argv);
-
-  /* No fragmentation and no RTS/CTS */
-  Config::SetDefault ("ns3::WifiRemoteStationManager::FragmentationThreshold", StringValue ("999999"));
-  // Config::SetDefault ("ns3::WifiRemoteStationManager::RtsCtsThreshold", StringValue ("1000"));
-  // ns3::FlowMonitorHelper
-
-  /* Configure TCP Options */
-  Config::SetDefault ("ns3::TcpSocket::SegmentSize", UintegerValue (payloadSize));
-
-  // WifiAddPropagationLoss ("ns3::LogDistancePropagationLossModel", "Exponent", DoubleValue (3.0), "ReferenceLoss", DoubleValue (40.0459));
-
-
   std::string phyMode ("DsssRate11Mbps");
-  NodeContainer ap;
+  NodeContainer &ap = bss.ap;
   ap.Create(1);
-  NodeContainer sta;
+  NodeContainer &sta = bss.sta;
   sta.Create(8);
  
   WifiHelper wifi;
   wifi.SetStandard(WIFI_PHY_STANDARD_80211b);
 
-  YansWifiPhyHelper wifiPhy = YansWifiPhyHelper::Default();
+  YansWifiPhyHelper &wifiPhy = bss.phy;
+  wifiPhy = YansWifiPhyHelper::Default();
   // ns-3 supports RadioTap and Prism tracing extensions for 802.11
   wifiPhy.SetPcapDataLinkType(YansWifiPhyHelper::DLT_IEEE802_11_RADIO);
+  if (errorTables)
+    {
+      // The same NIST model, read from precomputed tables.
+      wifiPhy.SetErrorRateModel ("ns3::TableErrorRateModel", "Inner", StringValue ("ns3::NistErrorRateModel"));
+    }
 
   YansWifiChannelHelper wifiChannel;
   // reference loss must be changed since 802.11b is operating at 2.4GHz
   wifiChannel.SetPropagationDelay ("ns3::ConstantSpeedPropagationDelayModel");
   wifiChannel.AddPropagationLoss("ns3::LogDistancePropagationLossModel", "ReferenceLoss", DoubleValue (40.0459));
 
-  wifiPhy.SetChannel(wifiChannel.Create());
+  Ptr<YansWifiChannel> channel = wifiChannel.Create();
+  if (lossCache)
+    {
+      CachedPropagationLossModel::Install (channel);
+    }
+  wifiPhy.SetChannel(channel);
 
   //Add a non-Qos upper mac, and disable the rate control
   NqosWifiMacHelper wifiMac = NqosWifiMacHelper::Default();
@@ -135,13 +138,11 @@ main(int argc, char *argv[])
   // setup AP
   wifiMac.SetType("ns3::ApWifiMac", "Ssid", SsidValue(ssid));
   
-  NetDeviceContainer apDevice = wifi.Install(wifiPhy, wifiMac, ap);
-  NetDeviceContainer devices = apDevice;
+  bss.apDevices = wifi.Install(wifiPhy, wifiMac, ap);
 
   //setup station
   wifiMac.SetType("ns3::StaWifiMac", "Ssid", SsidValue(ssid), "ActiveProbing", BooleanValue(false));
-  NetDeviceContainer staDevice = wifi.Install(wifiPhy, wifiMac, sta);
-  devices.Add(staDevice);
+  bss.staDevices = wifi.Install(wifiPhy, wifiMac, sta);
 
   //Configure mobility
   MobilityHelper mobility;
@@ -155,6 +156,11 @@ main(int argc, char *argv[])
   mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
   mobility.Install (ap);
   mobility.Install (sta);
+
+  if (gridChannel)
+    {
+      Create<GridChannelIndex> ()->Install (channel, NetDeviceContainer (bss.apDevices, bss.staDevices));
+    }
   
   /* Internet stack */
   InternetStackHelper stack;
@@ -163,11 +169,39 @@ main(int argc, char *argv[])
 
   Ipv4AddressHelper address;
   address.SetBase ("10.0.0.0", "255.255.255.0");
-  Ipv4InterfaceContainer apInterface;
-  apInterface = address.Assign (devices);
+  bss.apInterfaces = address.Assign (bss.apDevices);
+  bss.staInterfaces = address.Assign (bss.staDevices);
   
   /* Populate routing table */
   Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
+}
+
+/*
+ * Runs one load point of the current replication on the prebuilt BSS and
+ * returns its results as a serialized ResultsRowGroup: the summary KPIs
+ * as scalars and one row per flow. Each job runs in its own worker process
+ * (see SweepRunner), so the applications and the Simulator are private to it.
+ */
+std::string
+RunLoadPoint (uint32_t point)
+{
+  /* Replica r of every load point draws from the same stream: common random numbers. */
+  uint32_t run = RngSeedManager::GetRun ();
+  double percentage = minLoad + loadPoints[point] * loadStep;
+
+  /* Every job writes its own traces, the workers run concurrently. */
+  std::ostringstream tag;
+  tag << "-" << (int) (percentage * 100 + 0.5);
+  if (replications > 1)
+    {
+      tag << "-r" << run;
+    }
+
+  bool columnar = (output == "columnar");
+
+  const BssTopology &bss = scenario.GetTopology ();
+  NodeContainer ap = bss.ap;
+  NodeContainer sta = bss.sta;
 
   /* Install TCP Receiver on the access point */
   PacketSinkHelper sinkHelper ("ns3::TcpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), 9));
@@ -175,18 +209,18 @@ main(int argc, char *argv[])
   sink = StaticCast<PacketSink> (sinkApp.Get (0));
 
   /* Install TCP/UDP Transmitter on the station */
-  OnOffHelper server ("ns3::TcpSocketFactory", (InetSocketAddress (apInterface.GetAddress (0), 9)));
+  OnOffHelper server ("ns3::TcpSocketFactory", (InetSocketAddress (bss.apInterfaces.GetAddress (0), 9)));
   server.SetAttribute ("PacketSize", UintegerValue (payloadSize));
   server.SetAttribute ("OnTime", StringValue ("ns3::ConstantRandomVariable[Constant=1]"));
   server.SetAttribute ("OffTime", StringValue ("ns3::ConstantRandomVariable[Constant=0]"));
   ApplicationContainer serverApp;
   double totalDataRate=11.0*percentage;
-  srand (time(NULL));
+  Ptr<UniformRandomVariable> split = CreateObject<UniformRandomVariable> ();
   double arr[8];
   double sum=0;
   for(int i=0;i<8;i++)
   {
-    arr[i]=rand()%20+10;
+    arr[i]=split->GetInteger (10, 29);
     sum+=arr[i];
   }
   for(int i=0;i<8;i++)
@@ -206,8 +240,16 @@ main(int argc, char *argv[])
  
   /* Start Applications */
   sinkApp.Start (Seconds (0.0));
-  serverApp.Start (Seconds (1.0));
-  Simulator::Schedule (Seconds (1.1), &CalculateThroughput);
+  serverApp.Start (ScenarioTemplate::Until (Seconds (1.0)));
+
+  /* Throughput of the sink every sampleInterval ms, from the time the sources start. */
+  ThroughputSampler sampler;
+  if (sampleInterval > 0)
+    {
+      sampler.Add (sink);
+      sampler.Configure (MilliSeconds (sampleInterval), (uint32_t) (simulationTime * 1000 / sampleInterval) + 1);
+      sampler.Start (ScenarioTemplate::Until (Seconds (1.0)));
+    }
 
 
 
@@ -219,78 +261,126 @@ main(int argc, char *argv[])
    
        
 
-  Ptr<FlowMonitor> flowMonitor = flowHelper.InstallAll();
-  Ptr<FlowMonitor> flowMonitor2 = flowHelper.Install(ap);
+  /* The FlowMonitors are only needed for the XML dumps of the csv output. */
+  Ptr<FlowMonitor> flowMonitor;
+  Ptr<FlowMonitor> flowMonitor2;
+  if (!columnar)
+    {
+      flowMonitor = flowHelper.InstallAll();
+      flowMonitor2 = flowHelper.Install(ap);
+    }
+
+  /* Streaming per-flow statistics, keyed by the FlowMonitor's flow ids */
+  FlowStatsCollector flowStats;
+  if (!columnar)
+    {
+      flowStats.SetClassifier (DynamicCast<Ipv4FlowClassifier> (flowHelper.GetClassifier ()));
+    }
+  flowStats.Install (ap);
+  flowStats.Install (sta);
+
+  /* With --steadyState the run ends once the batch means of throughput and delay have converged. */
+  SteadyStateDetector detector;
+  if (steadyState)
+    {
+      detector.Add (sinkApp);
+      detector.SetFlowStats (&flowStats);
+      detector.Configure (MilliSeconds (100), Seconds (minTime), ciTarget);
+      detector.Start (ScenarioTemplate::Until (Seconds (1.0)));
+    }
   // Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier>(flowHelper.GetClassifier()); 
   // Ptr<FlowMonitor> monitor1 = flowHelper.GetMonitor();
   // flowMonitor->SetFlowClassifier(classifier);
   // Ptr<FlowMonitor> fm=flowHelper.InstallAll(ap.get(0));
   
 
-   // Enable Traces 
+   // Enable Traces, written by a background thread
+  AsyncPcapWriter pcap;
   if (pcapTracing)
     {
-      wifiPhy.SetPcapDataLinkType (YansWifiPhyHelper::DLT_IEEE802_11_RADIO);
-      wifiPhy.EnablePcap ("AccessPoint", apDevice);
-      wifiPhy.EnablePcap ("Station", staDevice);
+      pcap.SetSnapLength (pcapSnapLen);
+      pcap.SetFrameTypes (AsyncPcapWriter::ParseFrameTypes (pcapFrames));
+      pcap.EnableWifi ("AccessPoint" + tag.str (), bss.apDevices);
+      pcap.EnableWifi ("Station" + tag.str (), bss.staDevices);
     }
   
   /* Start Simulation */
 
-  Simulator::Stop (Seconds (simulationTime + 1));
+  Simulator::Stop (ScenarioTemplate::Until (Seconds (simulationTime + 1)));
   Simulator::Run ();
+  pcap.Close ();
+  /* The time the sources ran, the rates are averaged over. */
+  double duration = steadyState ? detector.GetElapsed ().GetSeconds () : simulationTime;
+
+  for (uint32_t k = 0; k < sampler.GetNSamples (); ++k)
+    {
+      std::cout << sampler.GetSampleTime (k).GetSeconds () << "s: \t" << sampler.GetThroughput (k, 0) / 1e6 << " Mbit/s" << std::endl;
+    }
 
   double total=0;
-  flowMonitor->CheckForLostPackets ();
-  Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier> (flowHelper.GetClassifier ());
-  std::map<FlowId, FlowMonitor::FlowStats> stats = flowMonitor->GetFlowStats ();
-
-  double Jitters[16];
-  double RxPackets[16];
-  double TxPackets[16];
-  double DelaySum[16];
-  Ipv4Address source[16];
-  Ipv4Address destination[16];
-  
-  // double th_put[16];
+  if (!columnar)
+    {
+      flowMonitor->CheckForLostPackets ();
+    }
+
+  ResultsRowGroup group;
+  uint32_t colFlow = group.AddColumn ("flowId");
+  uint32_t colSrc = group.AddColumn ("srcAddr");
+  uint32_t colDst = group.AddColumn ("dstAddr");
+  uint32_t colSrcPort = group.AddColumn ("srcPort");
+  uint32_t colDstPort = group.AddColumn ("dstPort");
+  uint32_t colProto = group.AddColumn ("protocol");
+  uint32_t colTxPackets = group.AddColumn ("txPackets");
+  uint32_t colRxPackets = group.AddColumn ("rxPackets");
+  uint32_t colTxBytes = group.AddColumn ("txBytes");
+  uint32_t colRxBytes = group.AddColumn ("rxBytes");
+  uint32_t colDelay = group.AddColumn ("delayMean");
+  uint32_t colDelayStd = group.AddColumn ("delayStd");
+  uint32_t colJitter = group.AddColumn ("jitterMean");
+  uint32_t colJitterStd = group.AddColumn ("jitterStd");
+  uint32_t colTput = group.AddColumn ("throughputKbps");
 
-  double sum_delay=0;
   double sum_rxpackets=0;
   double sum_txpackets=0;
-  double sum_jitters=0;
+  SampleStats delays;
+  SampleStats jitters;
 
+  for (FlowId id = 1; id <= flowStats.GetNFlows (); ++id){
+      const FlowStatsCollector::FlowRecord &flow = flowStats.GetFlow (id);
 
-  for (std::map<FlowId, FlowMonitor::FlowStats>::const_iterator iter = stats.begin (); iter != stats.end (); ++iter){
-    // cout<<iter->first;
+      NS_LOG_UNCOND("Flow ID: " << id << " Src Addr " << flow.tuple.sourceAddress << " Dst Addr " << flow.tuple.destinationAddress);
+      NS_LOG_UNCOND("Tx Packets = " << flow.txPackets);
+      NS_LOG_UNCOND("Rx Packets = " << flow.rxPackets);
+      NS_LOG_UNCOND("Mean Jitter = " << flow.jitter.GetMean () << "s");
 
-
-      Ipv4FlowClassifier::FiveTuple t = classifier->FindFlow (iter->first);
-
-      int index=iter->first-1;
-      source[index]=t.sourceAddress;
-      destination[index]=t.destinationAddress;
-      TxPackets[index]=iter->second.txPackets;
-      RxPackets[index]=iter->second.rxPackets;
-      Jitters[index]=iter->second.jitterSum.GetNanoSeconds();
-      DelaySum[index]=iter->second.delaySum.GetNanoSeconds();
-
-      NS_LOG_UNCOND("Flow ID: " << iter->first << " Src Addr " << t.sourceAddress << " Dst Addr " << t.destinationAddress);
-      NS_LOG_UNCOND("Tx Packets = " << iter->second.txPackets);
-      NS_LOG_UNCOND("Rx Packets = " << iter->second.rxPackets);
-      NS_LOG_UNCOND("Jitter Sum = " << iter->second.jitterSum);
-
-      double tput=iter->second.rxBytes * 8.0 / (iter->second.timeLastRxPacket.GetSeconds()-iter->second.timeFirstTxPacket.GetSeconds()) / 1024 ;
+      /* A flow that delivered nothing has no receive time to divide by. */
+      double tput = flow.rxPackets > 0 && flow.lastRx > flow.firstTx
+        ? flow.rxBytes * 8.0 / (flow.lastRx.GetSeconds()-flow.firstTx.GetSeconds()) / 1024 : 0;
       NS_LOG_UNCOND("Throughput: " << tput << " Kbps");
-      NS_LOG_UNCOND("DelaySum = " << iter->second.delaySum);
-      // th_put[index]=tput;
+      NS_LOG_UNCOND("Mean Delay = " << flow.delay.GetMean () << "s");
 
-      sum_delay+=DelaySum[index];
-      sum_rxpackets+=RxPackets[index];
-      sum_txpackets+=TxPackets[index];
-      sum_jitters+=Jitters[index];
+      sum_rxpackets+=flow.rxPackets;
+      sum_txpackets+=flow.txPackets;
+      delays.Merge (flow.delay);
+      jitters.Merge (flow.jitter);
 
       total+=tput;
-        
+
+      group.Append (colFlow, id);
+      group.Append (colSrc, flow.tuple.sourceAddress.Get ());
+      group.Append (colDst, flow.tuple.destinationAddress.Get ());
+      group.Append (colSrcPort, flow.tuple.sourcePort);
+      group.Append (colDstPort, flow.tuple.destinationPort);
+      group.Append (colProto, flow.tuple.protocol);
+      group.Append (colTxPackets, flow.txPackets);
+      group.Append (colRxPackets, flow.rxPackets);
+      group.Append (colTxBytes, flow.txBytes);
+      group.Append (colRxBytes, flow.rxBytes);
+      group.Append (colDelay, flow.delay.GetMean ());
+      group.Append (colDelayStd, flow.delay.GetStddev ());
+      group.Append (colJitter, flow.jitter.GetMean ());
+      group.Append (colJitterStd, flow.jitter.GetStddev ());
+      group.Append (colTput, tput);
   }
   NS_LOG_UNCOND("Total throughput"<<total);
 
@@ -300,45 +390,18 @@ main(int argc, char *argv[])
 
 NS_LOG_UNCOND("\n\nReport\n\n");
 
-double mean_jitters=(sum_jitters)/(sum_rxpackets-1);
+/* Per-packet statistics over every flow, in milliseconds. */
+double mean_jitters=jitters.GetMean ()*1e3;
 NS_LOG_UNCOND("mean jitters="<<mean_jitters);
 
-double mean_delay=(sum_delay)/(sum_rxpackets);
-
-
-double variance_delay=0;
-double variance_jitters=0;
-for(int i=0;i<16;i++)
-{
-  if(RxPackets[i]>=2)
-    {
-      double temp=abs((Jitters[i])/(RxPackets[i]-1)-mean_jitters);
-      // NS_LOG_UNCOND("temp="<<temp<<" "<<"index"<<i<<" "<<Jitters[i]);
-      variance_jitters+=temp*temp;
-
-      
-    }
-    if(RxPackets[i]>0)
-    {
-      double temp2=abs((DelaySum[i])/(RxPackets[i])-mean_delay);
-      variance_delay+=temp2*temp2;
-
-    }
-    
-  
-
-}
-variance_jitters=variance_jitters/16;
-variance_delay=variance_delay/16;
+double mean_delay=delays.GetMean ()*1e3;
 
-NS_LOG_UNCOND("variance jitters="<<variance_jitters);
-double deviation_jitters=sqrt(variance_jitters);
+double deviation_jitters=jitters.GetStddev ()*1e3;
 NS_LOG_UNCOND("deviation jitters="<<deviation_jitters);
 
 NS_LOG_UNCOND("\n");
 NS_LOG_UNCOND("mean delay="<<mean_delay);
-NS_LOG_UNCOND("variance delay="<<variance_delay);
-double deviation_delay=sqrt(variance_delay);
+double deviation_delay=delays.GetStddev ()*1e3;
 NS_LOG_UNCOND("deviation delay="<<deviation_delay);
 
 
@@ -346,7 +409,7 @@ NS_LOG_UNCOND("Total Packets Transmitted="<<sum_txpackets);
 NS_LOG_UNCOND("Total Packets Received="<<sum_rxpackets);
 double packets_lost=sum_txpackets-sum_rxpackets;
 double percentage_loss=(packets_lost*100.0)/sum_txpackets;
-double rate_packet_loss=(packets_lost)/simulationTime;
+double rate_packet_loss=(packets_lost)/duration;
 NS_LOG_UNCOND("Total Packets Lost="<<packets_lost);
 NS_LOG_UNCOND("Percentage of Total Packets Lost="<<percentage_loss<<"%");
 NS_LOG_UNCOND("Rate of Packets Lost="<<rate_packet_loss<<" packets per second");
@@ -362,41 +425,198 @@ NS_LOG_UNCOND("Rate of Packets Lost="<<rate_packet_loss<<" packets per second");
 
 
 
-flowMonitor->SerializeToXmlFile("report1.xml", true, true);
-  flowMonitor2->SerializeToXmlFile("report2.xml", true, true);
+if (!columnar)
+  {
+    flowMonitor->SerializeToXmlFile("report1" + tag.str () + ".xml", true, true);
+    flowMonitor2->SerializeToXmlFile("report2" + tag.str () + ".xml", true, true);
+  }
 
   Simulator::Destroy ();
 
   
-  double averageThroughput = ((sink->GetTotalRx() * 8) / (1e6  * simulationTime));
+  double averageThroughput = ((sink->GetTotalRx() * 8) / (1e6  * duration));
   std::cout << "\nAverage throughtput: " << averageThroughput << " Mbit/s" << std::endl;
 
+  group.SetMeta ("percentage", percentage*100);
+  group.SetMeta ("run", run);
+  group.SetMeta ("duration", duration);
+  group.SetMeta ("throughput", averageThroughput);
+  group.SetMeta ("txPackets", sum_txpackets);
+  group.SetMeta ("rxPackets", sum_rxpackets);
+  group.SetMeta ("lossPercent", percentage_loss);
+  group.SetMeta ("lossRate", rate_packet_loss);
+  group.SetMeta ("delayMean", mean_delay);
+  group.SetMeta ("delayStd", deviation_delay);
+  group.SetMeta ("jitterMean", mean_jitters);
+  group.SetMeta ("jitterStd", deviation_jitters);
+
+  return group.Serialize ();
+}
 
+int
+main(int argc, char *argv[])
+{
+  uint32_t jobs = 0;                                 /* Concurrent load points, 0 uses every core. */
 
-double to_div=1000000.0;
-  out<<averageThroughput<<",";
-  out<<sum_txpackets<<",";
-  out<<sum_rxpackets<<",";
-  out<<percentage_loss<<",";
-  out<<rate_packet_loss<<",";
-  out<<mean_delay/to_div<<",";
-  out<<deviation_delay/to_div<<",";
-  out<<mean_jitters/to_div<<",";
-  out<<deviation_jitters/to_div<<",";
-  out<<"\n";
-
-
+  /* Command line argument parser setup. */
+  CommandLine cmd;
+  cmd.AddValue ("payloadSize", "Payload size in bytes", payloadSize);
+  cmd.AddValue ("dataRate", "Application data ate", dataRate);
+  cmd.AddValue ("tcpVariant", "Transport protocol to use: TcpTahoe, TcpReno, TcpNewReno, TcpWestwood, TcpWestwoodPlus ", tcpVariant);
+  cmd.AddValue ("phyRate", "Physical layer bitrate", phyRate);
+  cmd.AddValue ("simulationTime", "Simulation time in seconds", simulationTime);
+  cmd.AddValue ("pcap", "Enable/disable PCAP Tracing", pcapTracing);
+  cmd.AddValue ("pcapSnapLen", "Bytes captured per frame, e.g. 64 for the MAC header only", pcapSnapLen);
+  cmd.AddValue ("pcapFrames", "Comma-separated frame types to capture: data, control, beacon, management or all", pcapFrames);
+  cmd.AddValue ("minLoad", "First offered load, as a fraction of 11 Mbps", minLoad);
+  cmd.AddValue ("maxLoad", "Last offered load, as a fraction of 11 Mbps", maxLoad);
+  cmd.AddValue ("loadStep", "Offered load step between points", loadStep);
+  cmd.AddValue ("adaptive", "Run a coarse sweep and bisect to the saturation knee at loadStep resolution", adaptive);
+  cmd.AddValue ("replications", "Independent runs (RngRun values) per load point", replications);
+  cmd.AddValue ("jobs", "Number of simulations run in parallel (0: one per core)", jobs);
+  cmd.AddValue ("output", "Results format: csv (report.csv and FlowMonitor XML) or columnar", output);
+  cmd.AddValue ("sampleInterval", "Throughput sampling period in ms (0: no time series)", sampleInterval);
+  cmd.AddValue ("warmupFork", "Simulate the first second once and fork every load point from it", warmupFork);
+  cmd.AddValue ("lossCache", "Compute the path loss of each node pair once", lossCache);
+  cmd.AddValue ("errorTables", "Read the frame error rates from precomputed SNR tables", errorTables);
+  cmd.AddValue ("gridChannel", "Deliver each frame only to the PHYs above the detection threshold", gridChannel);
+  cmd.AddValue ("resultsFile", "File the columnar output appends to (read it with results-dump)", resultsFile);
+  cmd.AddValue ("steadyState", "Stop each run once throughput and delay have converged (simulationTime is then the maximum)", steadyState);
+  cmd.AddValue ("ciTarget", "Steady state: 95% confidence half width of the batch means, relative to the mean", ciTarget);
+  cmd.AddValue ("minTime", "Steady state: simulated seconds to run at least", minTime);
+  cmd.Parse (argc, argv);
+  NS_ABORT_MSG_IF (output != "csv" && output != "columnar", "Unknown --output " << output);
+  NS_ABORT_MSG_IF (!(loadStep > 0) || !(minLoad >= 0) || !(maxLoad >= minLoad),
+                   "Bad load sweep: --minLoad=" << minLoad << " --maxLoad=" << maxLoad << " --loadStep=" << loadStep);
+  NS_ABORT_MSG_IF ((maxLoad - minLoad) / loadStep > 10000,
+                   "Load sweep of more than 10000 points: raise --loadStep");
 
+  /* --RngRun selects the run number of the first replica. */
+  firstRun = RngSeedManager::GetRun ();
 
+  /* No fragmentation and no RTS/CTS */
+  Config::SetDefault ("ns3::WifiRemoteStationManager::FragmentationThreshold", StringValue ("999999"));
+  // Config::SetDefault ("ns3::WifiRemoteStationManager::RtsCtsThreshold", StringValue ("1000"));
+  // ns3::FlowMonitorHelper
 
+  /* Configure TCP Options */
+  Config::SetDefault ("ns3::TcpSocket::SegmentSize", UintegerValue (payloadSize));
 
+  // WifiAddPropagationLoss ("ns3::LogDistancePropagationLossModel", "Exponent", DoubleValue (3.0), "ReferenceLoss", DoubleValue (40.0459));
 
+  /* Count the points up front: accumulating loadStep drops the last one to rounding. */
+  uint32_t nPoints = (uint32_t) ((maxLoad - minLoad) / loadStep + 1e-9) + 1;
 
+  SweepRunner runner;
+  runner.SetMaxJobs (jobs);
+  scenario.SetBuilder (MakeCallback (&BuildBss));
+  if (warmupFork)
+    {
+      /* Nothing but association happens before the sources start at 1 s. */
+      scenario.SetWarmup (Seconds (1.0));
+    }
+  std::vector<std::string> results;
+  if (adaptive)
+    {
+      /* Rounds of points, each run in parallel, until the knee is one loadStep wide. */
+      KneeSearch search (nPoints, 4);
+      std::map<uint32_t, std::vector<std::string> > measured;
+      for (loadPoints = search.NextRound (); !loadPoints.empty (); loadPoints = search.NextRound ())
+        {
+          std::vector<std::string> round = scenario.Run (runner, firstRun, replications, loadPoints.size (), MakeCallback (&RunLoadPoint));
+          for (uint32_t k = 0; k < loadPoints.size (); ++k)
+            {
+              SampleStats delay, loss;
+              for (uint32_t r = 0; r < replications; ++r)
+                {
+                  ResultsRowGroup g;
+                  NS_ABORT_MSG_IF (g.Deserialize (round[k * replications + r].data (), round[k * replications + r].size ()) == 0,
+                                   "Malformed results from load point " << loadPoints[k]);
+                  delay.Add (g.GetMeta ("delayMean"));
+                  loss.Add (g.GetMeta ("lossPercent"));
+                }
+              search.Set (loadPoints[k], delay.GetMean (), loss.GetMean ());
+              measured[loadPoints[k]].assign (round.begin () + k * replications, round.begin () + (k + 1) * replications);
+            }
+        }
+      /* The results in load order, as a fixed sweep over the measured points would give them. */
+      for (std::map<uint32_t, std::vector<std::string> >::iterator i = measured.begin (); i != measured.end (); ++i)
+        {
+          loadPoints.push_back (i->first);
+          results.insert (results.end (), i->second.begin (), i->second.end ());
+        }
+      std::cout << "Adaptive sweep: " << loadPoints.size () << " of " << nPoints << " load points" << std::endl;
+    }
+  else
+    {
+      for (uint32_t point = 0; point < nPoints; ++point)
+        {
+          loadPoints.push_back (point);
+        }
+      results = scenario.Run (runner, firstRun, replications, nPoints, MakeCallback (&RunLoadPoint));
+    }
 
+  std::vector<ResultsRowGroup> groups (results.size ());
+  for (uint32_t i = 0; i < results.size (); ++i)
+    {
+      NS_ABORT_MSG_IF (groups[i].Deserialize (results[i].data (), results[i].size ()) == 0,
+                       "Malformed results from job " << i);
+    }
 
+  if (output == "columnar")
+    {
+      for (uint32_t i = 0; i < results.size (); ++i)
+        {
+          ResultsFile::Append (resultsFile, results[i]);
+        }
+    }
+  else
+    {
+      ofstream out;
+      out.open("report.csv");
+
+      out<<"percentage,"<<"Aver. Throughput,"<<"Total packets sent,"<<"Total packets received,"<<"Traffic dropped(%),"<<"Traffic Dropped(Rate),"<<"Aver. delay,"<<"Delay Std. Dev,"<<"Aver. Jitters,"<<"Jitters Std. Dev\n";
+      for (uint32_t i = 0; i < groups.size (); ++i)
+        {
+          const ResultsRowGroup &g = groups[i];
+          out<<g.GetMeta ("percentage")<<",";
+          out<<g.GetMeta ("throughput")<<",";
+          out<<g.GetMeta ("txPackets")<<",";
+          out<<g.GetMeta ("rxPackets")<<",";
+          out<<g.GetMeta ("lossPercent")<<",";
+          out<<g.GetMeta ("lossRate")<<",";
+          out<<g.GetMeta ("delayMean")<<",";
+          out<<g.GetMeta ("delayStd")<<",";
+          out<<g.GetMeta ("jitterMean")<<",";
+          out<<g.GetMeta ("jitterStd")<<",";
+          out<<"\n";
+        }
+      out.close ();
+    }
 
+  if (replications > 1)
+    {
+      /* Mean and 95% confidence interval across the replicas of each point. */
+      ofstream ci;
+      ci.open ("report-ci.csv");
+      ci<<"percentage,"<<"Replications,"<<"Aver. Throughput,"<<"Throughput CI95,"<<"Aver. delay,"<<"Delay CI95,"<<"Aver. Jitters,"<<"Jitters CI95\n";
+      for (uint32_t point = 0; point < loadPoints.size (); ++point)
+        {
+          SampleStats throughput, delay, jitter;
+          for (uint32_t r = 0; r < replications; ++r)
+            {
+              const ResultsRowGroup &g = groups[point * replications + r];
+              throughput.Add (g.GetMeta ("throughput"));
+              delay.Add (g.GetMeta ("delayMean"));
+              jitter.Add (g.GetMeta ("jitterMean"));
+            }
+          ci<<(minLoad + loadPoints[point] * loadStep)*100<<","<<replications<<",";
+          ci<<throughput.GetMean ()<<","<<throughput.GetConfidenceHalfWidth ()<<",";
+          ci<<delay.GetMean ()<<","<<delay.GetConfidenceHalfWidth ()<<",";
+          ci<<jitter.GetMean ()<<","<<jitter.GetConfidenceHalfWidth ()<<"\n";
+        }
+      ci.close ();
+    }
 
-  percentage+=0.05;
-}
   return 0;
 }
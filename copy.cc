@@ -42,6 +42,10 @@
 //               | AP Node |              | AP Node |
 //               +---------+              +---------+
 //
+// With --processes=N the BSSs are split across N local processes, BSS i
+// going to process i % N (see process-partition.h), and the CSMA backbone
+// is replaced by a BackboneChannel whose --backboneDelay is the lookahead.
+//
 
 #include "ns3/core-module.h"
 #include "ns3/mobility-module.h"
@@ -55,6 +59,7 @@
 #include <stdint.h>
 #include <sstream>
 #include <fstream>
+#include "process-partition.h"
 
 using namespace ns3;
 
@@ -64,14 +69,21 @@ int main (int argc, char *argv[])
   uint32_t nStas = 2;
   bool sendIp = true;
   bool writeMobility = false;
+  uint32_t processes = 1;
+  double backboneDelay = 50;
 
   CommandLine cmd;
   cmd.AddValue ("nWifis", "Number of wifi networks", nWifis);
   cmd.AddValue ("nStas", "Number of stations per wifi network", nStas);
   cmd.AddValue ("SendIp", "Send Ipv4 or raw packets", sendIp);
   cmd.AddValue ("writeMobility", "Write mobility trace", writeMobility);
+  cmd.AddValue ("processes", "Local processes the BSSs are split across", processes);
+  cmd.AddValue ("backboneDelay", "Backbone delay in us when split across processes (the lookahead)", backboneDelay);
   cmd.Parse (argc, argv);
 
+  ProcessPartition partition (processes);
+  bool distributed = partition.GetN () > 1;
+
   NodeContainer backboneNodes;
   NetDeviceContainer backboneDevices;
   Ipv4InterfaceContainer backboneInterfaces;
@@ -80,6 +92,7 @@ int main (int argc, char *argv[])
   std::vector<NetDeviceContainer> apDevices;
   std::vector<Ipv4InterfaceContainer> staInterfaces;
   std::vector<Ipv4InterfaceContainer> apInterfaces;
+  std::vector<std::vector<Ipv4Address> > staAddresses;
 
   InternetStackHelper stack;
   CsmaHelper csma;
@@ -87,9 +100,18 @@ int main (int argc, char *argv[])
   ip.SetBase ("192.168.0.0", "255.255.255.0");
 
   backboneNodes.Create (nWifis);
-  stack.Install (backboneNodes);
-
-  backboneDevices = csma.Install (backboneNodes);
+  Ptr<BackboneChannel> backboneChannel;
+  if (distributed)
+    {
+      backboneChannel = CreateObject<BackboneChannel> ();
+      backboneChannel->SetAttribute ("Delay", TimeValue (MicroSeconds (backboneDelay)));
+      partition.SetChannel (backboneChannel);
+    }
+  else
+    {
+      stack.Install (backboneNodes);
+      backboneDevices = csma.Install (backboneNodes);
+    }
 
   double wifiX = 0.0;
 
@@ -98,6 +120,25 @@ int main (int argc, char *argv[])
 
   for (uint32_t i = 0; i < nWifis; ++i)
     {
+      if (!partition.IsLocal (i))
+        {
+          // another process builds this BSS: only keep its addresses taken.
+          std::vector<Ipv4Address> addresses;
+          ip.NewAddress ();
+          for (uint32_t k = 0; k < nStas; ++k)
+            {
+              addresses.push_back (ip.NewAddress ());
+            }
+          staAddresses.push_back (addresses);
+          staNodes.push_back (NodeContainer ());
+          apDevices.push_back (NetDeviceContainer ());
+          apInterfaces.push_back (Ipv4InterfaceContainer ());
+          staDevices.push_back (NetDeviceContainer ());
+          staInterfaces.push_back (Ipv4InterfaceContainer ());
+          wifiX += 20.0;
+          continue;
+        }
+
       // calculate ssid for wifi subnetwork
       std::ostringstream oss;
       oss << "wifi-default-" << i;
@@ -132,8 +173,23 @@ int main (int argc, char *argv[])
                        "Ssid", SsidValue (ssid));
       apDev = wifi.Install (wifiPhy, wifiMac, backboneNodes.Get (i));
 
+      Ptr<NetDevice> backboneDevice;
+      if (distributed)
+        {
+          stack.Install (backboneNodes.Get (i));
+          Ptr<BackboneNetDevice> port = CreateObject<BackboneNetDevice> ();
+          port->SetAddress (ProcessPartition::MakeAddress (i, 1));
+          backboneNodes.Get (i)->AddDevice (port);
+          port->SetChannel (backboneChannel);
+          backboneDevice = port;
+        }
+      else
+        {
+          backboneDevice = backboneDevices.Get (i);
+        }
+
       NetDeviceContainer bridgeDev;
-      bridgeDev = bridge.Install (backboneNodes.Get (i), NetDeviceContainer (apDev, backboneDevices.Get (i)));
+      bridgeDev = bridge.Install (backboneNodes.Get (i), NetDeviceContainer (apDev, backboneDevice));
 
       // assign AP IP address to bridge, not wifi
       apInterface = ip.Assign (bridgeDev);
@@ -151,6 +207,22 @@ int main (int argc, char *argv[])
       staDev = wifi.Install (wifiPhy, wifiMac, sta);
       staInterface = ip.Assign (staDev);
 
+      std::vector<Ipv4Address> addresses;
+      for (uint32_t k = 0; k < staInterface.GetN (); ++k)
+        {
+          addresses.push_back (staInterface.GetAddress (k));
+        }
+      staAddresses.push_back (addresses);
+      if (distributed)
+        {
+          bridgeDev.Get (0)->SetAddress (ProcessPartition::MakeAddress (i, 0));
+          apDev.Get (0)->SetAddress (ProcessPartition::MakeAddress (i, 2));
+          for (uint32_t k = 0; k < staDev.GetN (); ++k)
+            {
+              staDev.Get (k)->SetAddress (ProcessPartition::MakeAddress (i, 3 + k));
+            }
+        }
+
       // save everything in containers.
       staNodes.push_back (sta);
       apDevices.push_back (apDev);
@@ -161,28 +233,32 @@ int main (int argc, char *argv[])
       wifiX += 20.0;
     }
 
-  Address dest;
-  std::string protocol;
-  if (sendIp)
-    {
-      dest = InetSocketAddress (staInterfaces[1].GetAddress (1), 1025);
-      protocol = "ns3::UdpSocketFactory";
-    }
-  else
+  if (partition.IsLocal (0))
     {
-      PacketSocketAddress tmp;
-      tmp.SetSingleDevice (staDevices[0].Get (0)->GetIfIndex ());
-      tmp.SetPhysicalAddress (staDevices[1].Get (0)->GetAddress ());
-      tmp.SetProtocol (0x807);
-      dest = tmp;
-      protocol = "ns3::PacketSocketFactory";
-    }
+      Address dest;
+      std::string protocol;
+      if (sendIp)
+        {
+          dest = InetSocketAddress (staAddresses[1][1], 1025);
+          protocol = "ns3::UdpSocketFactory";
+        }
+      else
+        {
+          PacketSocketAddress tmp;
+          tmp.SetSingleDevice (staDevices[0].Get (0)->GetIfIndex ());
+          tmp.SetPhysicalAddress (distributed ? Address (ProcessPartition::MakeAddress (1, 3))
+                                  : staDevices[1].Get (0)->GetAddress ());
+          tmp.SetProtocol (0x807);
+          dest = tmp;
+          protocol = "ns3::PacketSocketFactory";
+        }
 
-  OnOffHelper onoff = OnOffHelper (protocol, dest);
-  onoff.SetConstantRate (DataRate ("500kb/s"));
-  ApplicationContainer apps = onoff.Install (staNodes[0].Get (0));
-  apps.Start (Seconds (0.5));
-  apps.Stop (Seconds (3.0));
+      OnOffHelper onoff = OnOffHelper (protocol, dest);
+      onoff.SetConstantRate (DataRate ("500kb/s"));
+      ApplicationContainer apps = onoff.Install (staNodes[0].Get (0));
+      apps.Start (Seconds (0.5));
+      apps.Stop (Seconds (3.0));
+    }
 
   wifiPhy.EnablePcap ("wifi-wired-bridging", apDevices[0]);
   wifiPhy.EnablePcap ("wifi-wired-bridging", apDevices[1]);
@@ -190,10 +266,16 @@ int main (int argc, char *argv[])
   if (writeMobility)
     {
       AsciiTraceHelper ascii;
-      MobilityHelper::EnableAsciiAll (ascii.CreateFileStream ("wifi-wired-bridging.mob"));
+      std::ostringstream name;
+      name << "wifi-wired-bridging";
+      if (distributed)
+        {
+          name << "-p" << partition.GetRank ();
+        }
+      MobilityHelper::EnableAsciiAll (ascii.CreateFileStream (name.str () + ".mob"));
     }
 
-  Simulator::Stop (Seconds (5.0));
-  Simulator::Run ();
+  partition.Run (Seconds (5.0));
   Simulator::Destroy ();
+  partition.ExitIfChild ();
 }
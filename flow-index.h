@@ -0,0 +1,210 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef FLOW_INDEX_H
+#define FLOW_INDEX_H
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include <stdint.h>
+#include <ostream>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief Maps IPv4 addresses back to node indices in constant time.
+ *
+ * Addresses are registered at install time, in node order.  The map is a
+ * dense table covering the registered address range, which for the usual
+ * one-subnet address plans is a few entries per node; a lookup is a
+ * subtraction and an array read.
+ */
+class NodeIndexMap
+{
+public:
+  NodeIndexMap ();
+
+  /// Give every address of the container the next free index, in order.
+  void Add (const Ipv4InterfaceContainer &interfaces);
+  /// Give an address the next free index.
+  void Add (Ipv4Address address);
+
+  /// \return the number of indices handed out
+  uint32_t GetN (void) const;
+  /// \return the index of the address, or -1 if it was never added
+  int32_t Lookup (Ipv4Address address) const;
+
+private:
+  /// Largest address range the table may span.
+  static const uint32_t MAX_SPAN = 1 << 20;
+
+  uint32_t m_base;
+  std::vector<int32_t> m_table;
+  uint32_t m_n;
+};
+
+/**
+ * \brief Square matrix of per-pair values (e.g. throughput), sized at run
+ * time and stored as one contiguous row-major array.
+ */
+class FlowMatrix
+{
+public:
+  /// \param n rows and columns; every entry starts at zero
+  FlowMatrix (uint32_t n = 0);
+
+  uint32_t GetN (void) const;
+  double Get (uint32_t row, uint32_t column) const;
+  /// Add value to entry (row, column).
+  void Add (uint32_t row, uint32_t column, double value);
+
+  /// \return the sum of every entry
+  double GetTotal (void) const;
+  /// \return the sum of rows [rowBegin, rowEnd) restricted to columns [columnBegin, columnEnd)
+  double GetSum (uint32_t rowBegin, uint32_t rowEnd, uint32_t columnBegin, uint32_t columnEnd) const;
+
+  /// Print one line per row, entries separated by spaces.
+  void Print (std::ostream &os) const;
+
+private:
+  uint32_t m_n;
+  std::vector<double> m_values;
+};
+
+inline
+NodeIndexMap::NodeIndexMap ()
+  : m_base (0),
+    m_n (0)
+{
+}
+
+inline void
+NodeIndexMap::Add (const Ipv4InterfaceContainer &interfaces)
+{
+  for (uint32_t i = 0; i < interfaces.GetN (); ++i)
+    {
+      Add (interfaces.GetAddress (i));
+    }
+}
+
+inline void
+NodeIndexMap::Add (Ipv4Address address)
+{
+  uint32_t a = address.Get ();
+  if (m_table.empty ())
+    {
+      m_base = a;
+      m_table.push_back (-1);
+    }
+  else if (a < m_base)
+    {
+      NS_ABORT_MSG_IF (m_base + m_table.size () - a > MAX_SPAN, "NodeIndexMap: " << address << " is too far from the other addresses");
+      m_table.insert (m_table.begin (), m_base - a, -1);
+      m_base = a;
+    }
+  else if (a - m_base >= m_table.size ())
+    {
+      NS_ABORT_MSG_IF (a - m_base >= MAX_SPAN, "NodeIndexMap: " << address << " is too far from the other addresses");
+      m_table.resize (a - m_base + 1, -1);
+    }
+  NS_ABORT_MSG_IF (m_table[a - m_base] >= 0, "NodeIndexMap: " << address << " added twice");
+  m_table[a - m_base] = m_n++;
+}
+
+inline uint32_t
+NodeIndexMap::GetN (void) const
+{
+  return m_n;
+}
+
+inline int32_t
+NodeIndexMap::Lookup (Ipv4Address address) const
+{
+  uint32_t offset = address.Get () - m_base;
+  // Addresses below the base wrap around to large offsets.
+  if (offset >= m_table.size ())
+    {
+      return -1;
+    }
+  return m_table[offset];
+}
+
+inline
+FlowMatrix::FlowMatrix (uint32_t n)
+  : m_n (n),
+    m_values (n * n, 0.0)
+{
+}
+
+inline uint32_t
+FlowMatrix::GetN (void) const
+{
+  return m_n;
+}
+
+inline double
+FlowMatrix::Get (uint32_t row, uint32_t column) const
+{
+  NS_ASSERT (row < m_n && column < m_n);
+  return m_values[row * m_n + column];
+}
+
+inline void
+FlowMatrix::Add (uint32_t row, uint32_t column, double value)
+{
+  NS_ASSERT (row < m_n && column < m_n);
+  m_values[row * m_n + column] += value;
+}
+
+inline double
+FlowMatrix::GetTotal (void) const
+{
+  return GetSum (0, m_n, 0, m_n);
+}
+
+inline double
+FlowMatrix::GetSum (uint32_t rowBegin, uint32_t rowEnd, uint32_t columnBegin, uint32_t columnEnd) const
+{
+  NS_ASSERT (rowEnd <= m_n && columnEnd <= m_n);
+  double sum = 0;
+  for (uint32_t i = rowBegin; i < rowEnd; ++i)
+    {
+      const double *row = &m_values[i * m_n];
+      for (uint32_t j = columnBegin; j < columnEnd; ++j)
+        {
+          sum += row[j];
+        }
+    }
+  return sum;
+}
+
+inline void
+FlowMatrix::Print (std::ostream &os) const
+{
+  for (uint32_t i = 0; i < m_n; ++i)
+    {
+      for (uint32_t j = 0; j < m_n; ++j)
+        {
+          os << m_values[i * m_n + j] << " ";
+        }
+      os << std::endl;
+    }
+}
+
+} // namespace ns3
+
+#endif /* FLOW_INDEX_H */
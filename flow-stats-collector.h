@@ -0,0 +1,292 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef FLOW_STATS_COLLECTOR_H
+#define FLOW_STATS_COLLECTOR_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/flow-monitor-module.h"
+#include "sample-stats.h"
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief Packet tag carrying the flow and the send time of an IPv4 packet,
+ * from the sender's IP layer to the receiver's.
+ */
+class FlowStatsTag : public Tag
+{
+public:
+  static TypeId GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::FlowStatsTag")
+      .SetParent<Tag> ()
+      .AddConstructor<FlowStatsTag> ()
+    ;
+    return tid;
+  }
+  virtual TypeId GetInstanceTypeId (void) const
+  {
+    return GetTypeId ();
+  }
+
+  FlowStatsTag ()
+    : m_flowId (0),
+      m_txTime (0)
+  {
+  }
+  FlowStatsTag (FlowId flowId, Time txTime)
+    : m_flowId (flowId),
+      m_txTime (txTime.GetTimeStep ())
+  {
+  }
+
+  FlowId GetFlowId (void) const
+  {
+    return m_flowId;
+  }
+  Time GetTxTime (void) const
+  {
+    return TimeStep (m_txTime);
+  }
+
+  virtual uint32_t GetSerializedSize (void) const
+  {
+    return 4 + 8;
+  }
+  virtual void Serialize (TagBuffer buf) const
+  {
+    buf.WriteU32 (m_flowId);
+    buf.WriteU64 (m_txTime);
+  }
+  virtual void Deserialize (TagBuffer buf)
+  {
+    m_flowId = buf.ReadU32 ();
+    m_txTime = buf.ReadU64 ();
+  }
+  virtual void Print (std::ostream &os) const
+  {
+    os << "FlowId=" << m_flowId << " TxTime=" << m_txTime;
+  }
+
+private:
+  FlowId m_flowId;
+  int64_t m_txTime;
+};
+
+NS_OBJECT_ENSURE_REGISTERED (FlowStatsTag);
+
+/**
+ * \brief Streaming per-flow statistics, updated as packets are delivered.
+ *
+ * The collector hooks the SendOutgoing and LocalDeliver traces of the
+ * Ipv4L3Protocol of every node it is installed on.  Flows are identified by
+ * an Ipv4FlowClassifier; pass the one of a FlowMonitorHelper to get the same
+ * FlowIds as the FlowMonitor.  Each flow keeps its counters and a running
+ * mean and variance (SampleStats) of the one-way delay and of the jitter, so
+ * memory is constant per flow, there is no cap on the number of flows and
+ * nothing has to be copied out after Simulator::Run ().
+ *
+ * Delays and jitters are recorded in seconds; jitter follows FlowMonitor,
+ * i.e. the absolute difference of the delays of consecutive received packets.
+ */
+class FlowStatsCollector
+{
+public:
+  /// Statistics of one flow.
+  struct FlowRecord
+  {
+    FlowRecord ();
+
+    Ipv4FlowClassifier::FiveTuple tuple; //!< the flow's five-tuple
+    uint64_t txPackets;                  //!< packets sent
+    uint64_t txBytes;                    //!< IP bytes sent, header included, as FlowMonitor counts them
+    uint64_t rxPackets;                  //!< packets delivered
+    uint64_t rxBytes;                    //!< IP bytes delivered, header included
+    Time firstTx;                        //!< time the first packet was sent
+    Time lastRx;                         //!< time the last packet was delivered
+    Time lastDelay;                      //!< delay of the last delivered packet
+    SampleStats delay;                   //!< one-way delay of delivered packets
+    SampleStats jitter;                  //!< delay variation between deliveries
+  };
+
+  FlowStatsCollector ();
+
+  /**
+   * Classify packets with the given classifier instead of a private one.
+   * Must be called before Install.
+   */
+  void SetClassifier (Ptr<Ipv4FlowClassifier> classifier);
+
+  /// Hook the IPv4 stack of every node in the container.
+  void Install (NodeContainer nodes);
+  /// Hook the IPv4 stack of a single node.
+  void Install (Ptr<Node> node);
+
+  /// \return the number of flows seen so far; FlowIds run from 1 to this.
+  uint32_t GetNFlows (void) const;
+  /// \return the statistics of the flow with the given FlowId
+  const FlowRecord & GetFlow (FlowId flowId) const;
+
+  /// Clear every counter; flows already seen keep their FlowIds.
+  void Reset (void);
+
+private:
+  FlowRecord & Lookup (FlowId flowId);
+  void SendOutgoing (const Ipv4Header &header, Ptr<const Packet> packet, uint32_t interface);
+  void LocalDeliver (const Ipv4Header &header, Ptr<const Packet> packet, uint32_t interface);
+
+  Ptr<Ipv4FlowClassifier> m_classifier;
+  std::vector<FlowRecord> m_flows;
+};
+
+inline
+FlowStatsCollector::FlowRecord::FlowRecord ()
+  : txPackets (0),
+    txBytes (0),
+    rxPackets (0),
+    rxBytes (0)
+{
+}
+
+inline
+FlowStatsCollector::FlowStatsCollector ()
+{
+}
+
+inline void
+FlowStatsCollector::SetClassifier (Ptr<Ipv4FlowClassifier> classifier)
+{
+  m_classifier = classifier;
+}
+
+inline void
+FlowStatsCollector::Install (NodeContainer nodes)
+{
+  for (NodeContainer::Iterator i = nodes.Begin (); i != nodes.End (); ++i)
+    {
+      Install (*i);
+    }
+}
+
+inline void
+FlowStatsCollector::Install (Ptr<Node> node)
+{
+  if (m_classifier == 0)
+    {
+      m_classifier = Create<Ipv4FlowClassifier> ();
+    }
+  Ptr<Ipv4L3Protocol> ipv4 = node->GetObject<Ipv4L3Protocol> ();
+  NS_ABORT_MSG_IF (ipv4 == 0, "FlowStatsCollector: node " << node->GetId () << " has no IPv4 stack");
+  ipv4->TraceConnectWithoutContext ("SendOutgoing", MakeCallback (&FlowStatsCollector::SendOutgoing, this));
+  ipv4->TraceConnectWithoutContext ("LocalDeliver", MakeCallback (&FlowStatsCollector::LocalDeliver, this));
+}
+
+inline uint32_t
+FlowStatsCollector::GetNFlows (void) const
+{
+  return m_flows.size ();
+}
+
+inline const FlowStatsCollector::FlowRecord &
+FlowStatsCollector::GetFlow (FlowId flowId) const
+{
+  NS_ASSERT (flowId >= 1 && flowId <= m_flows.size ());
+  return m_flows[flowId - 1];
+}
+
+inline void
+FlowStatsCollector::Reset (void)
+{
+  for (std::vector<FlowRecord>::iterator i = m_flows.begin (); i != m_flows.end (); ++i)
+    {
+      Ipv4FlowClassifier::FiveTuple tuple = i->tuple;
+      *i = FlowRecord ();
+      i->tuple = tuple;
+    }
+}
+
+inline FlowStatsCollector::FlowRecord &
+FlowStatsCollector::Lookup (FlowId flowId)
+{
+  // The classifier hands out FlowIds densely, starting at 1.
+  if (flowId > m_flows.size ())
+    {
+      size_t first = m_flows.size ();
+      m_flows.resize (flowId);
+      for (size_t i = first; i < m_flows.size (); ++i)
+        {
+          m_flows[i].tuple = m_classifier->FindFlow (i + 1);
+        }
+    }
+  return m_flows[flowId - 1];
+}
+
+inline void
+FlowStatsCollector::SendOutgoing (const Ipv4Header &header, Ptr<const Packet> packet, uint32_t interface)
+{
+  if (header.GetDestination () == Ipv4Address::GetBroadcast ())
+    {
+      return;
+    }
+  FlowId flowId;
+  uint32_t packetId;
+  if (!m_classifier->Classify (header, packet, &flowId, &packetId))
+    {
+      return;
+    }
+  FlowRecord &flow = Lookup (flowId);
+  Time now = Simulator::Now ();
+  if (flow.txPackets == 0)
+    {
+      flow.firstTx = now;
+    }
+  flow.txPackets++;
+  flow.txBytes += packet->GetSize () + header.GetSerializedSize ();
+
+  // Same trick as Ipv4FlowProbe: the tag rides on the payload the stack sends.
+  FlowStatsTag tag (flowId, now);
+  const_cast<Packet *> (PeekPointer (packet))->AddPacketTag (tag);
+}
+
+inline void
+FlowStatsCollector::LocalDeliver (const Ipv4Header &header, Ptr<const Packet> packet, uint32_t interface)
+{
+  FlowStatsTag tag;
+  if (!const_cast<Packet *> (PeekPointer (packet))->RemovePacketTag (tag))
+    {
+      return;
+    }
+  FlowRecord &flow = Lookup (tag.GetFlowId ());
+  Time now = Simulator::Now ();
+  Time delay = now - tag.GetTxTime ();
+  if (flow.rxPackets > 0)
+    {
+      flow.jitter.Add (Abs (delay - flow.lastDelay).GetSeconds ());
+    }
+  flow.delay.Add (delay.GetSeconds ());
+  flow.lastDelay = delay;
+  flow.lastRx = now;
+  flow.rxPackets++;
+  flow.rxBytes += packet->GetSize () + header.GetSerializedSize ();
+}
+
+} // namespace ns3
+
+#endif /* FLOW_STATS_COLLECTOR_H */
@@ -0,0 +1,304 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef GRID_CHANNEL_INDEX_H
+#define GRID_CHANNEL_INDEX_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/propagation-module.h"
+#include "ns3/wifi-module.h"
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief Limits the receiver fan-out of a YansWifiChannel to the PHYs in
+ * range of the sender.
+ *
+ * YansWifiChannel::Send computes the path loss to, and schedules a reception
+ * at, every PHY on the channel, so a transmission costs O(N) events even when
+ * most receivers are far below the energy detection threshold and only drop
+ * the frame.  The channel's loop is not virtual, so instead of replacing it
+ * the index gives every PHY a channel of its own, with the same propagation
+ * loss and delay models, on which it sends and whose other members are the
+ * PHYs it can reach.  A transmission then costs in proportion to the nodes
+ * in range.
+ *
+ * A PHY is in range when the worst case of the loss model (highest
+ * TxPowerEnd plus TxGain, highest RxGain) gives it at least the lower of
+ * its EnergyDetectionThreshold and CcaMode1Threshold, less SetMarginDb ().
+ * The neighbours come from a uniform grid of cells as wide as that range,
+ * so building the index costs O(N) for a spread-out topology.  The range is
+ * found by probing the loss model with distance, so the model must be
+ * deterministic and decrease with distance (log-distance, Friis, range,
+ * three-log-distance, ...); random fading models need the plain channel.
+ *
+ * Energy below the thresholds is no longer added to the interference of
+ * the far receivers; raise the margin where the sum of many weak signals
+ * matters.
+ *
+ * For moving nodes, SetRefresh () rebuilds the index periodically, with
+ * the range widened by the distance two nodes can close in one period.
+ */
+class GridChannelIndex : public SimpleRefCount<GridChannelIndex>
+{
+public:
+  GridChannelIndex ();
+
+  /// Widen the range by this many dB below the thresholds (default 0).
+  void SetMarginDb (double margin);
+  /**
+   * Rebuild the index every interval, for nodes moving at up to maxSpeed
+   * m/s.  Must be called before Install ().
+   */
+  void SetRefresh (Time interval, double maxSpeed);
+
+  /**
+   * Take over the devices of channel: from now on each sends on its own
+   * channel, which shares the loss and delay models of this one.  The nodes
+   * must have their mobility models.
+   */
+  void Install (Ptr<YansWifiChannel> channel, NetDeviceContainer devices);
+
+  /// The range receivers are included within, in m.
+  double GetRange (void) const;
+  /// Mean number of receivers per sender after the last build.
+  double GetMeanFanOut (void) const;
+
+private:
+  typedef std::pair<int64_t, int64_t> Cell;
+
+  Cell GetCell (const Vector &position) const;
+  double FindRange (void) const;
+  void Build (void);
+  void Refresh (void);
+
+  Ptr<YansWifiChannel> m_prototype;
+  Ptr<PropagationLossModel> m_loss;
+  Ptr<PropagationDelayModel> m_delay;
+  std::vector<Ptr<YansWifiPhy> > m_phys;
+  std::vector<Ptr<MobilityModel> > m_mobility;
+  std::vector<Ptr<YansWifiChannel> > m_channels;
+  /// The channels of the previous build: their receptions may be in flight.
+  std::vector<Ptr<YansWifiChannel> > m_previous;
+  double m_marginDb;
+  Time m_interval;
+  double m_maxSpeed;
+  double m_range;
+  double m_cellSize;
+  uint64_t m_links;
+};
+
+inline
+GridChannelIndex::GridChannelIndex ()
+  : m_marginDb (0),
+    m_interval (Seconds (0)),
+    m_maxSpeed (0),
+    m_range (0),
+    m_cellSize (0),
+    m_links (0)
+{
+}
+
+inline void
+GridChannelIndex::SetMarginDb (double margin)
+{
+  m_marginDb = margin;
+}
+
+inline void
+GridChannelIndex::SetRefresh (Time interval, double maxSpeed)
+{
+  m_interval = interval;
+  m_maxSpeed = maxSpeed;
+}
+
+inline double
+GridChannelIndex::GetRange (void) const
+{
+  return m_range;
+}
+
+inline double
+GridChannelIndex::GetMeanFanOut (void) const
+{
+  return m_phys.empty () ? 0 : double (m_links) / m_phys.size ();
+}
+
+inline void
+GridChannelIndex::Install (Ptr<YansWifiChannel> channel, NetDeviceContainer devices)
+{
+  NS_ABORT_MSG_IF (!m_phys.empty (), "GridChannelIndex::Install called twice");
+  m_prototype = channel;
+  PointerValue loss, delay;
+  channel->GetAttribute ("PropagationLossModel", loss);
+  channel->GetAttribute ("PropagationDelayModel", delay);
+  m_loss = loss.Get<PropagationLossModel> ();
+  m_delay = delay.Get<PropagationDelayModel> ();
+  NS_ABORT_MSG_IF (m_loss == 0 || m_delay == 0, "The channel has no propagation loss or delay model");
+
+  for (NetDeviceContainer::Iterator i = devices.Begin (); i != devices.End (); ++i)
+    {
+      Ptr<WifiNetDevice> device = DynamicCast<WifiNetDevice> (*i);
+      NS_ABORT_MSG_IF (device == 0, "GridChannelIndex needs wifi devices");
+      Ptr<YansWifiPhy> phy = DynamicCast<YansWifiPhy> (device->GetPhy ());
+      Ptr<MobilityModel> mobility = device->GetNode ()->GetObject<MobilityModel> ();
+      NS_ABORT_MSG_IF (phy == 0 || mobility == 0, "Node " << device->GetNode ()->GetId ()
+                       << " needs a YansWifiPhy and a mobility model");
+      m_phys.push_back (phy);
+      m_mobility.push_back (mobility);
+    }
+  m_range = FindRange ();
+  Build ();
+  if (!m_interval.IsZero ())
+    {
+      Simulator::Schedule (m_interval, &GridChannelIndex::Refresh, Ptr<GridChannelIndex> (this));
+    }
+}
+
+inline double
+GridChannelIndex::FindRange (void) const
+{
+  double txPower = -1e9;
+  double rxGain = -1e9;
+  double threshold = 1e9;
+  for (uint32_t i = 0; i < m_phys.size (); ++i)
+    {
+      txPower = std::max (txPower, m_phys[i]->GetTxPowerEnd () + m_phys[i]->GetTxGain ());
+      rxGain = std::max (rxGain, m_phys[i]->GetRxGain ());
+      threshold = std::min (threshold, std::min (m_phys[i]->GetEdThreshold (),
+                                                 m_phys[i]->GetCcaMode1Threshold ()));
+    }
+  threshold -= m_marginDb;
+
+  Ptr<ConstantPositionMobilityModel> a = CreateObject<ConstantPositionMobilityModel> ();
+  Ptr<ConstantPositionMobilityModel> b = CreateObject<ConstantPositionMobilityModel> ();
+  a->SetPosition (Vector (0, 0, 0));
+  // Grow the distance until the signal falls below the threshold, then
+  // bisect to a tenth of a metre.
+  double near = 0;
+  double far = 1;
+  while (true)
+    {
+      b->SetPosition (Vector (far, 0, 0));
+      if (m_loss->CalcRxPower (txPower, a, b) + rxGain < threshold)
+        {
+          break;
+        }
+      near = far;
+      far *= 2;
+      NS_ABORT_MSG_IF (far > 1e7, "The propagation loss model does not fall below "
+                       << threshold << " dBm with distance");
+    }
+  while (far - near > 0.1)
+    {
+      double middle = (near + far) / 2;
+      b->SetPosition (Vector (middle, 0, 0));
+      if (m_loss->CalcRxPower (txPower, a, b) + rxGain < threshold)
+        {
+          far = middle;
+        }
+      else
+        {
+          near = middle;
+        }
+    }
+  return far;
+}
+
+inline GridChannelIndex::Cell
+GridChannelIndex::GetCell (const Vector &position) const
+{
+  return Cell (int64_t (std::floor (position.x / m_cellSize)), int64_t (std::floor (position.y / m_cellSize)));
+}
+
+inline void
+GridChannelIndex::Build (void)
+{
+  // Both ends may move towards each other until the next refresh.
+  double reach = m_range + 2 * m_maxSpeed * m_interval.GetSeconds ();
+  m_cellSize = reach;
+
+  std::map<Cell, std::vector<uint32_t> > grid;
+  std::vector<Vector> positions (m_phys.size ());
+  for (uint32_t i = 0; i < m_phys.size (); ++i)
+    {
+      positions[i] = m_mobility[i]->GetPosition ();
+      grid[GetCell (positions[i])].push_back (i);
+    }
+
+  m_previous.swap (m_channels);
+  m_channels.clear ();
+  m_links = 0;
+  std::vector<uint32_t> neighbours;
+  for (uint32_t i = 0; i < m_phys.size (); ++i)
+    {
+      Cell cell = GetCell (positions[i]);
+      neighbours.clear ();
+      for (int64_t dx = -1; dx <= 1; ++dx)
+        {
+          for (int64_t dy = -1; dy <= 1; ++dy)
+            {
+              std::map<Cell, std::vector<uint32_t> >::const_iterator found
+                = grid.find (Cell (cell.first + dx, cell.second + dy));
+              if (found == grid.end ())
+                {
+                  continue;
+                }
+              for (uint32_t k = 0; k < found->second.size (); ++k)
+                {
+                  uint32_t j = found->second[k];
+                  if (j != i && CalculateDistance (positions[i], positions[j]) <= reach)
+                    {
+                      neighbours.push_back (j);
+                    }
+                }
+            }
+        }
+      // Keep the receivers in installation order, as the shared channel
+      // schedules them, so that simultaneous receptions keep their order.
+      std::sort (neighbours.begin (), neighbours.end ());
+
+      Ptr<YansWifiChannel> channel = CreateObject<YansWifiChannel> ();
+      channel->SetPropagationLossModel (m_loss);
+      channel->SetPropagationDelayModel (m_delay);
+      m_phys[i]->SetChannel (channel);
+      for (uint32_t k = 0; k < neighbours.size (); ++k)
+        {
+          channel->Add (m_phys[neighbours[k]]);
+        }
+      m_channels.push_back (channel);
+      m_links += neighbours.size ();
+    }
+}
+
+inline void
+GridChannelIndex::Refresh (void)
+{
+  Build ();
+  Simulator::Schedule (m_interval, &GridChannelIndex::Refresh, Ptr<GridChannelIndex> (this));
+}
+
+} // namespace ns3
+
+#endif /* GRID_CHANNEL_INDEX_H */
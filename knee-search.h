@@ -0,0 +1,176 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef KNEE_SEARCH_H
+#define KNEE_SEARCH_H
+
+#include "ns3/core-module.h"
+#include <stdint.h>
+#include <algorithm>
+#include <map>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief Picks the load points of a sweep round by round, bracketing the
+ * saturation knee by bisection.
+ *
+ * The loads lie on a grid of nGrid points, as a fixed-step sweep would run
+ * them all.  Below saturation delay and loss barely move with the load and
+ * above it they only grow, so most of those points add nothing to the
+ * curve.  The first round measures every coarseStep-th grid point and the
+ * last one.  A point is saturated when its delay exceeds SetDelayFactor ()
+ * times the delay at the lowest load, or its loss exceeds SetLossLimit ().
+ * Every later round measures the grid point halfway between the first
+ * saturated point and the measured point below it, until the two are one
+ * grid step apart: the curve then has the resolution of the full grid where
+ * it bends and the coarse one elsewhere.  A curve that never saturates, or
+ * saturates at the lowest load, ends after the first round.
+ */
+class KneeSearch
+{
+public:
+  /**
+   * \param nGrid the number of grid points
+   * \param coarseStep the grid steps between the points of the first round
+   */
+  KneeSearch (uint32_t nGrid, uint32_t coarseStep = 4);
+
+  /// \param factor delay over the lowest-load delay that means saturated (default 2)
+  void SetDelayFactor (double factor);
+  /// \param limit loss, in the unit of Set (), that means saturated (default 1)
+  void SetLossLimit (double limit);
+
+  /**
+   * \return the grid points to measure next, in increasing order; empty
+   *         when the search is over.  Every point of a round must be Set ()
+   *         before the next call.
+   */
+  std::vector<uint32_t> NextRound (void);
+
+  /// Record the mean delay and the loss measured at a grid point.
+  void Set (uint32_t point, double delay, double loss);
+
+  /// \return the grid points measured so far, in increasing order
+  std::vector<uint32_t> GetMeasured (void) const;
+
+private:
+  struct Sample
+  {
+    double delay;
+    double loss;
+  };
+
+  uint32_t m_nGrid;
+  uint32_t m_coarseStep;
+  double m_delayFactor;
+  double m_lossLimit;
+  bool m_started;
+  std::vector<uint32_t> m_pending;
+  std::map<uint32_t, Sample> m_samples;
+};
+
+inline
+KneeSearch::KneeSearch (uint32_t nGrid, uint32_t coarseStep)
+  : m_nGrid (nGrid),
+    m_coarseStep (std::max (coarseStep, 1u)),
+    m_delayFactor (2),
+    m_lossLimit (1),
+    m_started (false)
+{
+}
+
+inline void
+KneeSearch::SetDelayFactor (double factor)
+{
+  m_delayFactor = factor;
+}
+
+inline void
+KneeSearch::SetLossLimit (double limit)
+{
+  m_lossLimit = limit;
+}
+
+inline std::vector<uint32_t>
+KneeSearch::NextRound (void)
+{
+  for (uint32_t i = 0; i < m_pending.size (); ++i)
+    {
+      NS_ABORT_MSG_IF (m_samples.find (m_pending[i]) == m_samples.end (),
+                       "KneeSearch: grid point " << m_pending[i] << " was not measured");
+    }
+  m_pending.clear ();
+
+  if (!m_started)
+    {
+      m_started = true;
+      for (uint32_t i = 0; i < m_nGrid; i += m_coarseStep)
+        {
+          m_pending.push_back (i);
+        }
+      if (m_nGrid > 0 && m_pending.back () != m_nGrid - 1)
+        {
+          m_pending.push_back (m_nGrid - 1);
+        }
+      return m_pending;
+    }
+
+  if (m_samples.empty ())
+    {
+      return m_pending;
+    }
+  double baseDelay = m_samples.begin ()->second.delay;
+  std::map<uint32_t, Sample>::const_iterator below = m_samples.end ();
+  for (std::map<uint32_t, Sample>::const_iterator i = m_samples.begin (); i != m_samples.end (); ++i)
+    {
+      if (i->second.delay > m_delayFactor * baseDelay || i->second.loss > m_lossLimit)
+        {
+          // i is the first saturated point; split the interval below it.
+          if (below != m_samples.end () && i->first - below->first >= 2)
+            {
+              m_pending.push_back ((below->first + i->first) / 2);
+            }
+          break;
+        }
+      below = i;
+    }
+  return m_pending;
+}
+
+inline void
+KneeSearch::Set (uint32_t point, double delay, double loss)
+{
+  NS_ABORT_MSG_IF (point >= m_nGrid, "KneeSearch: grid point " << point << " out of range");
+  Sample sample = { delay, loss };
+  m_samples[point] = sample;
+}
+
+inline std::vector<uint32_t>
+KneeSearch::GetMeasured (void) const
+{
+  std::vector<uint32_t> points;
+  for (std::map<uint32_t, Sample>::const_iterator i = m_samples.begin (); i != m_samples.end (); ++i)
+    {
+      points.push_back (i->first);
+    }
+  return points;
+}
+
+} // namespace ns3
+
+#endif /* KNEE_SEARCH_H */
@@ -0,0 +1,357 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef LADDER_SCHEDULER_H
+#define LADDER_SCHEDULER_H
+
+#include "ns3/core-module.h"
+#include "ns3/map-scheduler.h"
+#include "ns3/heap-scheduler.h"
+#include "ns3/list-scheduler.h"
+#include "ns3/calendar-scheduler.h"
+#include "benchmark-report.h"
+#include <stdint.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief Ladder queue: an event scheduler with O(1) amortized insert and
+ * remove, after Tang, Goh and Thng, "Ladder Queue: An O(1) Priority Queue
+ * Structure for Large-Scale Discrete Event Simulation" (2005).
+ *
+ * Events are kept in three tiers:
+ *
+ *  - top: an unsorted vector of the events at or past m_topStart, where
+ *    most new events of a busy simulation land at O(1);
+ *  - the ladder: rungs of time buckets, each rung splitting one bucket of
+ *    the rung above into finer buckets, until a bucket is small enough;
+ *  - bottom: a small sorted vector (latest first) the next events are
+ *    popped from.
+ *
+ * Only the bottom is ever sorted and it stays short, so the dense bursts
+ * of near-simultaneous backoff, ACK timeout and PHY events of a contended
+ * BSS cost little more than a vector push each.  Ties are broken by event
+ * uid, like the other ns-3 schedulers, so a simulation gives the same
+ * results with every scheduler.
+ */
+class LadderScheduler : public Scheduler
+{
+public:
+  static TypeId GetTypeId (void);
+
+  LadderScheduler ();
+
+  virtual void Insert (const Scheduler::Event &ev);
+  virtual bool IsEmpty (void) const;
+  virtual Scheduler::Event PeekNext (void) const;
+  virtual Scheduler::Event RemoveNext (void);
+  virtual void Remove (const Scheduler::Event &ev);
+
+private:
+  /// A bucket larger than this is split into a new rung.
+  static const uint32_t THRESHOLD = 50;
+  static const uint32_t MAX_RUNGS = 8;
+
+  struct Rung
+  {
+    uint64_t start;                       //!< time of bucket 0
+    uint64_t width;                       //!< time span of a bucket
+    uint32_t current;                     //!< first bucket not yet consumed
+    uint32_t count;                       //!< events in the rung
+    std::vector<std::vector<Scheduler::Event> > buckets;
+  };
+
+  static bool Later (const Scheduler::Event &a, const Scheduler::Event &b);
+  void InsertBottom (const Scheduler::Event &ev);
+  void Refill (void);
+  void Spawn (uint64_t start, uint64_t span, std::vector<Scheduler::Event> &events);
+  static bool Erase (std::vector<Scheduler::Event> &events, const Scheduler::Event &ev);
+
+  std::vector<Scheduler::Event> m_top;
+  uint64_t m_topStart;                    //!< events at or past this go to the top
+  uint64_t m_topMin;
+  uint64_t m_topMax;
+  std::vector<Rung> m_rungs;              //!< rung storage, reused
+  uint32_t m_nRungs;                      //!< rungs in use, outermost first
+  std::vector<Scheduler::Event> m_bottom; //!< sorted, next event last
+  uint32_t m_count;
+};
+
+/**
+ * Select the event scheduler of the simulations of this process by name:
+ * "map" (the ns-3 default), "heap", "list", "calendar" or "ladder".  Call it
+ * before the first use of the simulator and before BenchmarkReport::Start
+ * or ProfilingScheduler::Enable, which keep the choice for their counting.
+ */
+inline void
+SelectScheduler (std::string name)
+{
+  std::string type;
+  if (name == "map")
+    {
+      type = "ns3::MapScheduler";
+    }
+  else if (name == "heap")
+    {
+      type = "ns3::HeapScheduler";
+    }
+  else if (name == "list")
+    {
+      type = "ns3::ListScheduler";
+    }
+  else if (name == "calendar")
+    {
+      type = "ns3::CalendarScheduler";
+    }
+  else if (name == "ladder")
+    {
+      type = "ns3::LadderScheduler";
+    }
+  else
+    {
+      NS_ABORT_MSG ("Unknown scheduler \"" << name << "\": map, heap, list, calendar or ladder");
+    }
+  GlobalValue::Bind ("SchedulerType", StringValue (type));
+  Config::SetDefault ("ns3::CountingScheduler::Inner", StringValue (type));
+}
+
+NS_OBJECT_ENSURE_REGISTERED (LadderScheduler);
+
+inline TypeId
+LadderScheduler::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::LadderScheduler")
+    .SetParent<Scheduler> ()
+    .SetGroupName ("Core")
+    .AddConstructor<LadderScheduler> ()
+  ;
+  return tid;
+}
+
+inline
+LadderScheduler::LadderScheduler ()
+  : m_topStart (0),
+    m_topMin (0),
+    m_topMax (0),
+    m_rungs (MAX_RUNGS),
+    m_nRungs (0),
+    m_count (0)
+{
+}
+
+inline bool
+LadderScheduler::Later (const Scheduler::Event &a, const Scheduler::Event &b)
+{
+  return a.key.m_ts > b.key.m_ts || (a.key.m_ts == b.key.m_ts && a.key.m_uid > b.key.m_uid);
+}
+
+inline void
+LadderScheduler::InsertBottom (const Scheduler::Event &ev)
+{
+  m_bottom.insert (std::upper_bound (m_bottom.begin (), m_bottom.end (), ev, &LadderScheduler::Later), ev);
+}
+
+inline void
+LadderScheduler::Insert (const Scheduler::Event &ev)
+{
+  m_count++;
+  uint64_t ts = ev.key.m_ts;
+  if (ts >= m_topStart)
+    {
+      if (m_top.empty ())
+        {
+          m_topMin = m_topMax = ts;
+        }
+      m_topMin = std::min (m_topMin, ts);
+      m_topMax = std::max (m_topMax, ts);
+      m_top.push_back (ev);
+    }
+  else
+    {
+      // Rungs cover successively earlier times, each ending where the
+      // unconsumed buckets of the rung above begin; the bottom is below all.
+      uint32_t i;
+      for (i = 0; i < m_nRungs; ++i)
+        {
+          Rung &rung = m_rungs[i];
+          if (ts >= rung.start + rung.current * rung.width)
+            {
+              rung.buckets[(ts - rung.start) / rung.width].push_back (ev);
+              rung.count++;
+              break;
+            }
+        }
+      if (i == m_nRungs)
+        {
+          InsertBottom (ev);
+        }
+    }
+  if (m_bottom.empty ())
+    {
+      Refill ();
+    }
+}
+
+inline bool
+LadderScheduler::IsEmpty (void) const
+{
+  return m_count == 0;
+}
+
+inline Scheduler::Event
+LadderScheduler::PeekNext (void) const
+{
+  NS_ASSERT (!m_bottom.empty ());
+  return m_bottom.back ();
+}
+
+inline Scheduler::Event
+LadderScheduler::RemoveNext (void)
+{
+  NS_ASSERT (!m_bottom.empty ());
+  Scheduler::Event ev = m_bottom.back ();
+  m_bottom.pop_back ();
+  m_count--;
+  if (m_bottom.empty () && m_count > 0)
+    {
+      Refill ();
+    }
+  return ev;
+}
+
+inline void
+LadderScheduler::Spawn (uint64_t start, uint64_t span, std::vector<Scheduler::Event> &events)
+{
+  Rung &rung = m_rungs[m_nRungs++];
+  rung.start = start;
+  rung.width = std::max<uint64_t> (1, (span + events.size () - 1) / events.size ());
+  rung.current = 0;
+  rung.count = events.size ();
+  uint32_t nBuckets = (span + rung.width - 1) / rung.width;
+  if (rung.buckets.size () < nBuckets)
+    {
+      rung.buckets.resize (nBuckets);
+    }
+  for (uint32_t b = 0; b < nBuckets; ++b)
+    {
+      rung.buckets[b].clear ();
+    }
+  rung.buckets.resize (nBuckets);
+  for (std::vector<Scheduler::Event>::const_iterator i = events.begin (); i != events.end (); ++i)
+    {
+      rung.buckets[(i->key.m_ts - start) / rung.width].push_back (*i);
+    }
+  events.clear ();
+}
+
+inline void
+LadderScheduler::Refill (void)
+{
+  NS_ASSERT (m_bottom.empty ());
+  while (true)
+    {
+      while (m_nRungs > 0 && m_rungs[m_nRungs - 1].count == 0)
+        {
+          m_nRungs--;
+        }
+      if (m_nRungs == 0)
+        {
+          if (m_top.empty ())
+            {
+              return;
+            }
+          // Move the top to a first rung; later events go to a new top.
+          uint64_t start = m_topMin;
+          uint64_t span = m_topMax - m_topMin + 1;
+          m_topStart = m_topMax + 1;
+          Spawn (start, span, m_top);
+          continue;
+        }
+
+      Rung &rung = m_rungs[m_nRungs - 1];
+      while (rung.buckets[rung.current].empty ())
+        {
+          rung.current++;
+        }
+      std::vector<Scheduler::Event> &bucket = rung.buckets[rung.current];
+      uint64_t bucketStart = rung.start + rung.current * rung.width;
+      rung.count -= bucket.size ();
+      rung.current++;
+      if (bucket.size () > THRESHOLD && rung.width > 1 && m_nRungs < MAX_RUNGS)
+        {
+          Spawn (bucketStart, rung.width, bucket);
+          continue;
+        }
+      m_bottom.swap (bucket);
+      std::sort (m_bottom.begin (), m_bottom.end (), &LadderScheduler::Later);
+      return;
+    }
+}
+
+inline bool
+LadderScheduler::Erase (std::vector<Scheduler::Event> &events, const Scheduler::Event &ev)
+{
+  for (std::vector<Scheduler::Event>::iterator i = events.begin (); i != events.end (); ++i)
+    {
+      if (i->key.m_uid == ev.key.m_uid)
+        {
+          events.erase (i);
+          return true;
+        }
+    }
+  return false;
+}
+
+inline void
+LadderScheduler::Remove (const Scheduler::Event &ev)
+{
+  uint64_t ts = ev.key.m_ts;
+  bool found = false;
+  if (ts >= m_topStart)
+    {
+      found = Erase (m_top, ev);
+    }
+  else
+    {
+      for (uint32_t i = 0; i < m_nRungs && !found; ++i)
+        {
+          Rung &rung = m_rungs[i];
+          if (ts >= rung.start + rung.current * rung.width)
+            {
+              found = Erase (rung.buckets[(ts - rung.start) / rung.width], ev);
+              rung.count -= found;
+              break;
+            }
+        }
+      if (!found)
+        {
+          found = Erase (m_bottom, ev);
+        }
+    }
+  NS_ASSERT (found);
+  m_count--;
+  if (m_bottom.empty () && m_count > 0)
+    {
+      Refill ();
+    }
+}
+
+} // namespace ns3
+
+#endif /* LADDER_SCHEDULER_H */
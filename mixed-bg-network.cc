@@ -25,6 +25,11 @@
 #include "ns3/mobility-module.h"
 #include "ns3/ipv4-global-routing-helper.h"
 #include "ns3/internet-module.h"
+#include "sweep-runner.h"
+#include "benchmark-report.h"
+#include <cstdlib>
+#include <sstream>
+#include <vector>
 
 // This example shows how the presence of an 802.11b station in an 802.11g network does affect the performance.
 //
@@ -55,24 +60,96 @@ using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE ("ErpAndNonErp");
 
+/**
+ * One row of the comparison: everything a run depends on, including the
+ * protection mode of the remote station managers, which is set on the
+ * WifiHelper of that run rather than as a process-wide default.
+ */
+struct ExperimentConfig
+{
+  std::string protectionMode;    //!< "Rts-Cts" or "Cts-To-Self"
+  bool enableProtection;         //!< the AP protects ERP transmissions
+  bool enableShortSlotTime;      //!< short slot time supported by the AP and G station
+  bool enableShortPlcpPreamble;  //!< short PLCP preamble supported by the B station
+  bool isMixed;                  //!< an 802.11b station is associated
+  bool isUdp;                    //!< UDP if true, TCP otherwise
+};
+
+/**
+ * Runs a table of configurations, each in a worker process of its own
+ * (see SweepRunner), and returns their throughputs in table order.
+ */
 class Experiment
 {
 public:
-  Experiment ();
-  double Run (bool enableProtection, bool enableShortSlotTime, bool enableShortPlcpPreamble, bool isMixed, bool isUdp, uint32_t payloadSize, uint32_t simulationTime);
+  Experiment (uint32_t payloadSize, uint32_t simulationTime);
+
+  /// Append a configuration to the table.
+  void Add (ExperimentConfig config);
+  /// \return the configuration table
+  const std::vector<ExperimentConfig> & GetConfigs (void) const;
+
+  /// \return the throughput of every configuration, in Mbit/s
+  std::vector<double> Run (SweepRunner &runner);
+
+private:
+  std::string RunJob (uint32_t index);
+  double Run (const ExperimentConfig &config);
+
+  uint32_t m_payloadSize;
+  uint32_t m_simulationTime;
+  std::vector<ExperimentConfig> m_configs;
 };
 
-Experiment::Experiment ()
+Experiment::Experiment (uint32_t payloadSize, uint32_t simulationTime)
+  : m_payloadSize (payloadSize),
+    m_simulationTime (simulationTime)
+{
+}
+
+void
+Experiment::Add (ExperimentConfig config)
+{
+  m_configs.push_back (config);
+}
+
+const std::vector<ExperimentConfig> &
+Experiment::GetConfigs (void) const
 {
+  return m_configs;
+}
+
+std::vector<double>
+Experiment::Run (SweepRunner &runner)
+{
+  std::vector<std::string> results = runner.Run (m_configs.size (), MakeCallback (&Experiment::RunJob, this));
+  std::vector<double> throughputs;
+  for (uint32_t i = 0; i < results.size (); ++i)
+    {
+      throughputs.push_back (std::atof (results[i].c_str ()));
+    }
+  return throughputs;
+}
+
+std::string
+Experiment::RunJob (uint32_t index)
+{
+  std::ostringstream result;
+  result.precision (17);
+  result << Run (m_configs[index]);
+  return result.str ();
 }
 
 double
-Experiment::Run (bool enableProtection, bool enableShortSlotTime, bool enableShortPlcpPreamble, bool isMixed, bool isUdp, uint32_t payloadSize, uint32_t simulationTime)
+Experiment::Run (const ExperimentConfig &config)
 {
+  bool isUdp = config.isUdp;
+  uint32_t payloadSize = m_payloadSize;
+  uint32_t simulationTime = m_simulationTime;
   double throughput = 0;
   uint32_t totalPacketsThrough = 0;
   uint32_t nWifiB = 0;
-  if (isMixed)
+  if (config.isMixed)
     {
       nWifiB = 1;
     }
@@ -92,7 +169,8 @@ Experiment::Run (bool enableProtection, bool enableShortSlotTime, bool enableSho
   phy.SetChannel (channel.Create ());
 
   WifiHelper wifi;
-  wifi.SetRemoteStationManager ("ns3::IdealWifiManager");
+  wifi.SetRemoteStationManager ("ns3::IdealWifiManager",
+                                "ProtectionMode", StringValue (config.protectionMode));
 
   // 802.11b STA
   wifi.SetStandard (WIFI_PHY_STANDARD_80211b);
@@ -102,10 +180,10 @@ Experiment::Run (bool enableProtection, bool enableShortSlotTime, bool enableSho
 
   mac.SetType ("ns3::StaWifiMac",
                "Ssid", SsidValue (ssid),
-               "ShortSlotTimeSupported", BooleanValue (enableShortSlotTime));
+               "ShortSlotTimeSupported", BooleanValue (config.enableShortSlotTime));
     
   // Configure the PLCP preamble type: long or short
-  phy.Set ("ShortPlcpPreambleSupported", BooleanValue (enableShortPlcpPreamble));
+  phy.Set ("ShortPlcpPreambleSupported", BooleanValue (config.enableShortPlcpPreamble));
 
   NetDeviceContainer bStaDevice;
   bStaDevice = wifi.Install (phy, mac, wifiBStaNodes);
@@ -119,8 +197,8 @@ Experiment::Run (bool enableProtection, bool enableShortSlotTime, bool enableSho
   mac.SetType ("ns3::ApWifiMac",
                "Ssid", SsidValue (ssid),
                "BeaconGeneration", BooleanValue (true),
-               "EnableNonErpProtection", BooleanValue (enableProtection),
-               "ShortSlotTimeSupported", BooleanValue (enableShortSlotTime));
+               "EnableNonErpProtection", BooleanValue (config.enableProtection),
+               "ShortSlotTimeSupported", BooleanValue (config.enableShortSlotTime));
     
   NetDeviceContainer apDevice;
   apDevice = wifi.Install (phy, mac, wifiApNode);
@@ -130,7 +208,7 @@ Experiment::Run (bool enableProtection, bool enableShortSlotTime, bool enableSho
   Ptr<ListPositionAllocator> positionAlloc = CreateObject<ListPositionAllocator> ();
   
   positionAlloc->Add (Vector (0.0, 0.0, 0.0));
-  if (isMixed)
+  if (config.isMixed)
   {
     positionAlloc->Add (Vector (5.0, 0.0, 0.0));
   }
@@ -222,84 +300,80 @@ int main (int argc, char *argv[])
   uint32_t payloadSize = 1472; //bytes
   uint32_t simulationTime = 10; //seconds
   bool isUdp = true;
+  bool bothTransports = false;
+  uint32_t jobs = 0;
+  std::string benchmark = "scratch/mixed-bg-network.bands";
+  bool recordBenchmark = false;
   
   CommandLine cmd;
   cmd.AddValue ("payloadSize", "Payload size in bytes", payloadSize);
   cmd.AddValue ("simulationTime", "Simulation time in seconds", simulationTime);
   cmd.AddValue ("isUdp", "UDP if set to 1, TCP otherwise", isUdp);
+  cmd.AddValue ("bothTransports", "Run every configuration over UDP and over TCP", bothTransports);
+  cmd.AddValue ("jobs", "Number of simulations run in parallel (0: one per core)", jobs);
+  cmd.AddValue ("benchmark", "Expected throughput and performance bands to check the run against", benchmark);
+  cmd.AddValue ("recordBenchmark", "Write the --benchmark bands file from this run instead of checking it", recordBenchmark);
   cmd.Parse (argc, argv);
 
-  Experiment experiment;
-  double throughput = 0;
-  std::cout << "Protection mode" << "\t\t" << "Slot time supported" << "\t\t" << "PLCP preamble supported" << "\t\t" << "Scenario" << "\t" << "Throughput" << std::endl;
+  BenchmarkReport report ("mixed-bg-network");
+  report.Start ();
 
-  throughput = experiment.Run (false, false, false, false, isUdp, payloadSize, simulationTime);
-  if (throughput < 23 || throughput > 24)
-    {
-      NS_LOG_ERROR ("Obtained throughput " << throughput << " is not in the expected boundaries!");
-      exit (1);
-    }
-  std::cout << "Disabled" << "\t\t" << "Long" << "\t\t\t\t" << "Long" << "\t\t\t\t" << "G-only" << "\t\t" << throughput <<" Mbit/s" << std::endl;
-  
-  throughput = experiment.Run (false, true, false, false, isUdp, payloadSize, simulationTime);
-  if (throughput < 29 || throughput > 30)
-    {
-      NS_LOG_ERROR ("Obtained throughput " << throughput << " is not in the expected boundaries!");
-      exit (1);
-    }
-  std::cout << "Disabled" << "\t\t" << "Short" << "\t\t\t\t" << "Long" << "\t\t\t\t" << "G-only" << "\t\t" << throughput <<" Mbit/s" << std::endl;
-  
-  throughput = experiment.Run (false, false, false, true, isUdp, payloadSize, simulationTime);
-  if (throughput < 23 || throughput > 24)
-    {
-      NS_LOG_ERROR ("Obtained throughput " << throughput << " is not in the expected boundaries!");
-      exit (1);
-    }
-  std::cout << "Disabled" << "\t\t" << "Long" << "\t\t\t\t" << "Long" << "\t\t\t\t" << "Mixed" << "\t\t" << throughput <<" Mbit/s" << std::endl;
-  
-  throughput = experiment.Run (false, false, true, true, isUdp, payloadSize, simulationTime);
-  if (throughput < 23 || throughput > 24)
-    {
-      NS_LOG_ERROR ("Obtained throughput " << throughput << " is not in the expected boundaries!");
-      exit (1);
-    }
-  std::cout << "Disabled" << "\t\t" << "Long" << "\t\t\t\t" << "Short" << "\t\t\t\t" << "Mixed" << "\t\t" << throughput <<" Mbit/s" << std::endl;
-  
-  Config::SetDefault ("ns3::WifiRemoteStationManager::ProtectionMode", StringValue ("Rts-Cts"));
-  
-  throughput = experiment.Run (true, false, false, true, isUdp, payloadSize, simulationTime);
-  if (throughput < 19 || throughput > 20)
-    {
-      NS_LOG_ERROR ("Obtained throughput " << throughput << " is not in the expected boundaries!");
-      exit (1);
-    }
-  std::cout << "RTS/CTS" << "\t\t\t" << "Long" << "\t\t\t\t" << "Long" << "\t\t\t\t" << "Mixed" << "\t\t" << throughput <<" Mbit/s" << std::endl;
-  
-  throughput = experiment.Run (true, false, true, true, isUdp, payloadSize, simulationTime);
-  if (throughput < 19 || throughput > 20)
+  // Protection mode, protection, short slot, short PLCP, mixed, UDP;
+  // the protection mode only matters to the rows with protection.
+  // The expected throughput of row i is the band of throughput-<udp|tcp>-i.
+  static const ExperimentConfig table[] = {
+    { "Cts-To-Self", false, false, false, false, true },
+    { "Cts-To-Self", false, true,  false, false, true },
+    { "Cts-To-Self", false, false, false, true,  true },
+    { "Cts-To-Self", false, false, true,  true,  true },
+    { "Rts-Cts",     true,  false, false, true,  true },
+    { "Rts-Cts",     true,  false, true,  true,  true },
+    { "Cts-To-Self", true,  false, false, true,  true },
+    { "Cts-To-Self", true,  false, true,  true,  true },
+  };
+  uint32_t nConfigs = sizeof (table) / sizeof (table[0]);
+
+  Experiment experiment (payloadSize, simulationTime);
+  for (uint32_t transport = 0; transport < (bothTransports ? 2 : 1); ++transport)
     {
-      NS_LOG_ERROR ("Obtained throughput " << throughput << " is not in the expected boundaries!");
-      exit (1);
+      for (uint32_t i = 0; i < nConfigs; ++i)
+        {
+          ExperimentConfig config = table[i];
+          config.isUdp = bothTransports ? (transport == 0) : isUdp;
+          experiment.Add (config);
+        }
     }
-  std::cout << "RTS/CTS" << "\t\t\t" << "Long" << "\t\t\t\t" << "Short" << "\t\t\t\t" << "Mixed" << "\t\t" << throughput <<" Mbit/s" << std::endl;
-  
-  Config::SetDefault ("ns3::WifiRemoteStationManager::ProtectionMode", StringValue ("Cts-To-Self"));
-  
-  throughput = experiment.Run (true, false, false, true, isUdp, payloadSize, simulationTime);
-  if (throughput < 21 || throughput > 22)
+
+  SweepRunner runner;
+  runner.SetMaxJobs (jobs);
+  std::vector<double> throughputs = experiment.Run (runner);
+
+  std::cout << "Protection mode" << "\t\t" << "Slot time supported" << "\t\t" << "PLCP preamble supported" << "\t\t" << "Scenario" << "\t" << "Throughput" << std::endl;
+  const std::vector<ExperimentConfig> &configs = experiment.GetConfigs ();
+  for (uint32_t i = 0; i < configs.size (); ++i)
     {
-      NS_LOG_ERROR ("Obtained throughput " << throughput << " is not in the expected boundaries!");
-      exit (1);
+      const ExperimentConfig &config = configs[i];
+      double throughput = throughputs[i];
+      std::ostringstream kpi;
+      kpi << "throughput-" << (config.isUdp ? "udp" : "tcp") << "-" << i % nConfigs;
+      report.AddKpi (kpi.str (), throughput);
+      std::string protection = !config.enableProtection ? "Disabled\t"
+        : (config.protectionMode == "Rts-Cts" ? "RTS/CTS\t\t" : "CTS-TO-SELF\t");
+      std::cout << protection << "\t" << (config.enableShortSlotTime ? "Short" : "Long") << "\t\t\t\t"
+                << (config.enableShortPlcpPreamble ? "Short" : "Long") << "\t\t\t\t"
+                << (config.isMixed ? "Mixed" : "G-only") << "\t\t" << throughput << " Mbit/s";
+      if (bothTransports)
+        {
+          std::cout << "\t" << (config.isUdp ? "UDP" : "TCP");
+        }
+      std::cout << std::endl;
     }
-  std::cout << "CTS-TO-SELF" << "\t\t" << "Long" << "\t\t\t\t" << "Long" << "\t\t\t\t" << "Mixed" << "\t\t" << throughput <<" Mbit/s" << std::endl;
-  
-  throughput = experiment.Run (true, false, true, true, isUdp, payloadSize, simulationTime);
-  if (throughput < 21 || throughput > 22)
+
+  std::cout << std::endl;
+  if (report.Finish (benchmark, recordBenchmark, std::cout) > 0)
     {
-      NS_LOG_ERROR ("Obtained throughput " << throughput << " is not in the expected boundaries!");
+      NS_LOG_ERROR ("Obtained throughput is not in the expected boundaries!");
       exit (1);
     }
-  std::cout << "CTS-TO-SELF" << "\t\t" << "Long" << "\t\t\t\t" << "Short" << "\t\t\t\t" << "Mixed" << "\t\t" << throughput <<" Mbit/s" << std::endl;
-  
   return 0;
 }
@@ -0,0 +1,406 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PACKET_POOL_H
+#define PACKET_POOL_H
+
+#include <stdint.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace ns3 {
+
+/**
+ * \brief Per-thread free lists for the small blocks every frame allocates.
+ *
+ * On its way from an OnOff application to the air and back up to a
+ * PacketSink, a frame allocates its Packet, its packet tags, and the events
+ * and callbacks that carry it, all with new, and frees them all again when
+ * it is received or dropped.  The data of its Buffer and its metadata come
+ * from free lists of ns-3 itself and mostly bypass this pool.  Packet and
+ * the events live in the libraries, out of reach of a scratch program, so
+ * this header replaces the global operator new and delete of the program
+ * instead: blocks of up to 2 KiB are rounded up to 16 bytes, carved from
+ * 256 KiB chunks and, once freed, kept on a free list per size for the next
+ * frame, so a steady state simulation stops calling malloc.  Larger blocks
+ * go to malloc.
+ *
+ * Every block has a 16 byte header with its size class and the cache of the
+ * thread that allocated it.  The free lists of a cache are used by its
+ * thread only and need no locking.  A block freed on another thread, by the
+ * pcap writer for instance, is pushed on a lock-free list of the owning
+ * cache, which its thread takes back when a free list runs empty, so blocks
+ * always return to the thread that allocates them.  The cache of a thread
+ * that exits is adopted by the next thread that starts.  Memory is never
+ * given back to the system, which is the point: the simulation's peak is
+ * what it keeps.
+ *
+ * The replacement operators cannot be inline, so they are only defined
+ * where PACKET_POOL_REPLACE_NEW is defined before the include, in exactly
+ * one translation unit of a program; without it the header only declares
+ * PacketPool.  Enable (false) sends the later allocations to malloc, for
+ * comparisons.
+ */
+class PacketPool
+{
+public:
+  static void Enable (bool enable);
+  static bool IsEnabled (void);
+
+  /// Blocks this thread took from its free lists.
+  static uint64_t GetRecycled (void);
+  /// Blocks this thread carved from fresh chunks.
+  static uint64_t GetCarved (void);
+  /// Blocks this thread got from malloc.
+  static uint64_t GetLarge (void);
+
+  /// \returns size bytes aligned for any type, or 0 when out of memory
+  static void *Allocate (std::size_t size);
+  static void Free (void *p);
+
+private:
+  static const std::size_t GRANULE = 16;
+  /// Size classes: class c holds blocks of (c + 1) * GRANULE bytes.
+  static const uint32_t CLASSES = 128;
+  /// The size class of the blocks from malloc.
+  static const uint32_t LARGE = CLASSES;
+  static const std::size_t CHUNK = 256 * 1024;
+
+  struct Cache;
+
+  /// In front of every block; one granule, which keeps the blocks aligned.
+  struct alignas (GRANULE) Header
+  {
+    union
+    {
+      Cache *owner;               //!< while allocated
+      Header *next;               //!< while on a free list
+    };
+    uint32_t sizeClass;
+  };
+  static_assert (sizeof (Header) == GRANULE, "PacketPool: the header must be one granule");
+  static_assert (alignof (std::max_align_t) <= GRANULE, "PacketPool: blocks would be misaligned");
+
+  struct Cache
+  {
+    Header *free[CLASSES];
+    std::atomic<Header *> remote;  //!< blocks freed by other threads
+    char *next;                   //!< the unused part of the current chunk
+    char *end;
+    uint64_t recycled;
+    uint64_t carved;
+    uint64_t large;
+    std::atomic<bool> inUse;      //!< owned by a running thread
+    Cache *link;                  //!< next cache ever created
+  };
+
+  /// Releases the cache of a thread when it exits.
+  struct Releaser
+  {
+    Cache **slot;
+    ~Releaser ();
+  };
+
+  /// \returns the cache of this thread, or 0 once the thread is exiting
+  static Cache *GetCache (void);
+  /// \returns a cache left by an exited thread, or a new one
+  static Cache *Adopt (void);
+  /// Move the blocks freed by other threads to the free lists.
+  static void TakeRemote (Cache &cache);
+
+  static bool &GetEnabled (void);
+  static std::atomic<Cache *> &GetCaches (void);
+};
+
+inline bool &
+PacketPool::GetEnabled (void)
+{
+  static bool enabled = true;
+  return enabled;
+}
+
+inline void
+PacketPool::Enable (bool enable)
+{
+  GetEnabled () = enable;
+}
+
+inline bool
+PacketPool::IsEnabled (void)
+{
+  return GetEnabled ();
+}
+
+inline std::atomic<PacketPool::Cache *> &
+PacketPool::GetCaches (void)
+{
+  static std::atomic<Cache *> caches (0);
+  return caches;
+}
+
+inline
+PacketPool::Releaser::~Releaser ()
+{
+  Cache *cache = *slot;
+  *slot = 0;
+  cache->inUse.store (false, std::memory_order_release);
+}
+
+inline PacketPool::Cache *
+PacketPool::Adopt (void)
+{
+  std::atomic<Cache *> &caches = GetCaches ();
+  for (Cache *cache = caches.load (std::memory_order_acquire); cache != 0; cache = cache->link)
+    {
+      bool idle = false;
+      if (cache->inUse.compare_exchange_strong (idle, true, std::memory_order_acquire))
+        {
+          return cache;
+        }
+    }
+  // Caches are never freed: blocks of an exited thread may still come back.
+  Cache *cache = static_cast<Cache *> (std::calloc (1, sizeof (Cache)));
+  if (cache == 0)
+    {
+      return 0;
+    }
+  new (&cache->remote) std::atomic<Header *> (0);
+  new (&cache->inUse) std::atomic<bool> (true);
+  cache->link = caches.load (std::memory_order_relaxed);
+  while (!caches.compare_exchange_weak (cache->link, cache, std::memory_order_release))
+    {
+    }
+  return cache;
+}
+
+inline PacketPool::Cache *
+PacketPool::GetCache (void)
+{
+  // Trivial, so that they need no guard and outlive the releaser.
+  static thread_local Cache *cache = 0;
+  static thread_local bool adopted = false;
+  if (!adopted)
+    {
+      adopted = true;
+      cache = Adopt ();
+      if (cache != 0)
+        {
+          static thread_local Releaser releaser;
+          releaser.slot = &cache;
+        }
+    }
+  return cache;
+}
+
+inline uint64_t
+PacketPool::GetRecycled (void)
+{
+  Cache *cache = GetCache ();
+  return cache != 0 ? cache->recycled : 0;
+}
+
+inline uint64_t
+PacketPool::GetCarved (void)
+{
+  Cache *cache = GetCache ();
+  return cache != 0 ? cache->carved : 0;
+}
+
+inline uint64_t
+PacketPool::GetLarge (void)
+{
+  Cache *cache = GetCache ();
+  return cache != 0 ? cache->large : 0;
+}
+
+inline void
+PacketPool::TakeRemote (Cache &cache)
+{
+  Header *block = cache.remote.exchange (0, std::memory_order_acquire);
+  while (block != 0)
+    {
+      Header *next = block->next;
+      block->next = cache.free[block->sizeClass];
+      cache.free[block->sizeClass] = block;
+      block = next;
+    }
+}
+
+inline void *
+PacketPool::Allocate (std::size_t size)
+{
+  Cache *cache = GetEnabled () ? GetCache () : 0;
+  std::size_t needed = size + sizeof (Header);
+  Header *header;
+  if (cache != 0 && size <= CLASSES * GRANULE - sizeof (Header))
+    {
+      uint32_t sizeClass = (needed - 1) / GRANULE;
+      if (cache->free[sizeClass] == 0 && cache->remote.load (std::memory_order_relaxed) != 0)
+        {
+          TakeRemote (*cache);
+        }
+      header = cache->free[sizeClass];
+      if (header != 0)
+        {
+          cache->free[sizeClass] = header->next;
+          cache->recycled++;
+        }
+      else
+        {
+          std::size_t bytes = (sizeClass + 1) * GRANULE;
+          if (std::size_t (cache->end - cache->next) < bytes)
+            {
+              // The tail of the old chunk, under 2 KiB, is left unused.
+              char *chunk = static_cast<char *> (std::malloc (CHUNK));
+              if (chunk == 0)
+                {
+                  return 0;
+                }
+              cache->next = chunk;
+              cache->end = chunk + CHUNK;
+            }
+          header = reinterpret_cast<Header *> (cache->next);
+          cache->next += bytes;
+          cache->carved++;
+        }
+      header->owner = cache;
+      header->sizeClass = sizeClass;
+    }
+  else
+    {
+      header = static_cast<Header *> (std::malloc (needed));
+      if (header == 0)
+        {
+          return 0;
+        }
+      header->owner = 0;
+      header->sizeClass = LARGE;
+      if (cache != 0)
+        {
+          cache->large++;
+        }
+    }
+  return header + 1;
+}
+
+inline void
+PacketPool::Free (void *p)
+{
+  if (p == 0)
+    {
+      return;
+    }
+  Header *header = static_cast<Header *> (p) - 1;
+  if (header->sizeClass == LARGE)
+    {
+      std::free (header);
+      return;
+    }
+  Cache *owner = header->owner;
+  if (owner == GetCache ())
+    {
+      header->next = owner->free[header->sizeClass];
+      owner->free[header->sizeClass] = header;
+      return;
+    }
+  // Another thread's block, or this thread is exiting: hand it back.
+  header->next = owner->remote.load (std::memory_order_relaxed);
+  while (!owner->remote.compare_exchange_weak (header->next, header, std::memory_order_release,
+                                               std::memory_order_relaxed))
+    {
+    }
+}
+
+} // namespace ns3
+
+#ifdef PACKET_POOL_REPLACE_NEW
+
+// The replacements must not be inline: they are found by the linker, for
+// the ns-3 libraries too.  Every form is replaced, as the library's nothrow
+// new may call malloc directly and its blocks would lack the header.
+
+void *
+operator new (std::size_t size)
+{
+  void *p = ns3::PacketPool::Allocate (size);
+  if (p == 0)
+    {
+      throw std::bad_alloc ();
+    }
+  return p;
+}
+
+void *
+operator new[] (std::size_t size)
+{
+  return operator new (size);
+}
+
+void *
+operator new (std::size_t size, const std::nothrow_t &) noexcept
+{
+  return ns3::PacketPool::Allocate (size);
+}
+
+void *
+operator new[] (std::size_t size, const std::nothrow_t &) noexcept
+{
+  return ns3::PacketPool::Allocate (size);
+}
+
+void
+operator delete (void *p) noexcept
+{
+  ns3::PacketPool::Free (p);
+}
+
+void
+operator delete[] (void *p) noexcept
+{
+  ns3::PacketPool::Free (p);
+}
+
+void
+operator delete (void *p, const std::nothrow_t &) noexcept
+{
+  ns3::PacketPool::Free (p);
+}
+
+void
+operator delete[] (void *p, const std::nothrow_t &) noexcept
+{
+  ns3::PacketPool::Free (p);
+}
+
+#ifdef __cpp_sized_deallocation
+void
+operator delete (void *p, std::size_t) noexcept
+{
+  ns3::PacketPool::Free (p);
+}
+
+void
+operator delete[] (void *p, std::size_t) noexcept
+{
+  ns3::PacketPool::Free (p);
+}
+#endif
+
+#endif /* PACKET_POOL_REPLACE_NEW */
+
+#endif /* PACKET_POOL_H */
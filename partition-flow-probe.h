@@ -0,0 +1,312 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PARTITION_FLOW_PROBE_H
+#define PARTITION_FLOW_PROBE_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/flow-monitor-module.h"
+#include <stdint.h>
+#include <cstdlib>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief Byte tag with the time a packet left its sender's IP layer.
+ */
+class TxTimeTag : public Tag
+{
+public:
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (TagBuffer buffer) const;
+  virtual void Deserialize (TagBuffer buffer);
+  virtual void Print (std::ostream &os) const;
+
+  int64_t m_txTime;                 //!< in time steps
+};
+
+/**
+ * \brief Per-flow IPv4 statistics that work when the two ends of a flow
+ * are simulated by different processes of a ProcessPartition.
+ *
+ * FlowMonitor matches a received packet with the record its sender made,
+ * in its own memory, so it loses every flow that crosses the partition.
+ * This probe carries what the receiver needs in the packet instead: the
+ * sender stamps a TxTimeTag, which survives the backbone, and the
+ * receiver computes the delay and jitter from it.  Each process counts the
+ * sending side of its flows and the receiving side of its flows; Merge ()
+ * adds the processes' Serialize () strings up into FlowMonitor::FlowStats,
+ * with the same definitions as FlowMonitor's.
+ */
+class PartitionFlowProbe
+{
+public:
+  /// Watch the IPv4 traffic of the nodes.
+  void Install (NodeContainer nodes);
+
+  /// The local statistics, for ProcessPartition::Gather ().
+  std::string Serialize (void) const;
+
+  /**
+   * Add up the statistics of every process.  Flows are numbered from 1 in
+   * five-tuple order.
+   */
+  static void Merge (const std::vector<std::string> &parts,
+                     std::map<FlowId, FlowMonitor::FlowStats> &stats,
+                     std::map<FlowId, Ipv4FlowClassifier::FiveTuple> &tuples);
+
+private:
+  typedef std::map<Ipv4FlowClassifier::FiveTuple, FlowMonitor::FlowStats> FlowMap;
+
+  static Ipv4FlowClassifier::FiveTuple Classify (const Ipv4Header &header, Ptr<const Packet> packet);
+  static FlowMonitor::FlowStats &Get (FlowMap &flows, const Ipv4FlowClassifier::FiveTuple &tuple);
+  void SendOutgoing (const Ipv4Header &header, Ptr<const Packet> packet, uint32_t interface);
+  void LocalDeliver (const Ipv4Header &header, Ptr<const Packet> packet, uint32_t interface);
+
+  FlowMap m_flows;
+};
+
+NS_OBJECT_ENSURE_REGISTERED (TxTimeTag);
+
+inline TypeId
+TxTimeTag::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::TxTimeTag")
+    .SetParent<Tag> ()
+    .SetGroupName ("FlowMonitor")
+    .AddConstructor<TxTimeTag> ()
+  ;
+  return tid;
+}
+
+inline TypeId
+TxTimeTag::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+inline uint32_t
+TxTimeTag::GetSerializedSize (void) const
+{
+  return 8;
+}
+
+inline void
+TxTimeTag::Serialize (TagBuffer buffer) const
+{
+  buffer.WriteU64 (m_txTime);
+}
+
+inline void
+TxTimeTag::Deserialize (TagBuffer buffer)
+{
+  m_txTime = buffer.ReadU64 ();
+}
+
+inline void
+TxTimeTag::Print (std::ostream &os) const
+{
+  os << "txTime=" << TimeStep (m_txTime).GetSeconds ();
+}
+
+inline void
+PartitionFlowProbe::Install (NodeContainer nodes)
+{
+  for (NodeContainer::Iterator i = nodes.Begin (); i != nodes.End (); ++i)
+    {
+      Ptr<Ipv4L3Protocol> ipv4 = (*i)->GetObject<Ipv4L3Protocol> ();
+      NS_ABORT_MSG_IF (ipv4 == 0, "PartitionFlowProbe: node " << (*i)->GetId () << " has no IPv4 stack");
+      ipv4->TraceConnectWithoutContext ("SendOutgoing", MakeCallback (&PartitionFlowProbe::SendOutgoing, this));
+      ipv4->TraceConnectWithoutContext ("LocalDeliver", MakeCallback (&PartitionFlowProbe::LocalDeliver, this));
+    }
+}
+
+inline Ipv4FlowClassifier::FiveTuple
+PartitionFlowProbe::Classify (const Ipv4Header &header, Ptr<const Packet> packet)
+{
+  Ipv4FlowClassifier::FiveTuple tuple;
+  tuple.sourceAddress = header.GetSource ();
+  tuple.destinationAddress = header.GetDestination ();
+  tuple.protocol = header.GetProtocol ();
+  tuple.sourcePort = 0;
+  tuple.destinationPort = 0;
+  if (tuple.protocol == TcpL4Protocol::PROT_NUMBER)
+    {
+      TcpHeader tcp;
+      packet->PeekHeader (tcp);
+      tuple.sourcePort = tcp.GetSourcePort ();
+      tuple.destinationPort = tcp.GetDestinationPort ();
+    }
+  else if (tuple.protocol == UdpL4Protocol::PROT_NUMBER)
+    {
+      UdpHeader udp;
+      packet->PeekHeader (udp);
+      tuple.sourcePort = udp.GetSourcePort ();
+      tuple.destinationPort = udp.GetDestinationPort ();
+    }
+  return tuple;
+}
+
+inline FlowMonitor::FlowStats &
+PartitionFlowProbe::Get (FlowMap &flows, const Ipv4FlowClassifier::FiveTuple &tuple)
+{
+  FlowMap::iterator found = flows.find (tuple);
+  if (found == flows.end ())
+    {
+      found = flows.insert (std::make_pair (tuple, FlowMonitor::FlowStats ())).first;
+    }
+  return found->second;
+}
+
+inline void
+PartitionFlowProbe::SendOutgoing (const Ipv4Header &header, Ptr<const Packet> packet, uint32_t interface)
+{
+  Time now = Simulator::Now ();
+  FlowMonitor::FlowStats &stats = Get (m_flows, Classify (header, packet));
+  if (stats.txPackets == 0)
+    {
+      stats.timeFirstTxPacket = now;
+    }
+  stats.timeLastTxPacket = now;
+  stats.txPackets++;
+  stats.txBytes += packet->GetSize () + header.GetSerializedSize ();
+
+  TxTimeTag tag;
+  tag.m_txTime = now.GetTimeStep ();
+  packet->AddByteTag (tag);
+}
+
+inline void
+PartitionFlowProbe::LocalDeliver (const Ipv4Header &header, Ptr<const Packet> packet, uint32_t interface)
+{
+  TxTimeTag tag;
+  bool found = false;
+  ByteTagIterator i = packet->GetByteTagIterator ();
+  while (i.HasNext () && !found)
+    {
+      ByteTagIterator::Item item = i.Next ();
+      if (item.GetTypeId () == TxTimeTag::GetTypeId ())
+        {
+          item.GetTag (tag);
+          found = true;
+        }
+    }
+  if (!found)
+    {
+      return;
+    }
+
+  Time now = Simulator::Now ();
+  Time delay = now - TimeStep (tag.m_txTime);
+  FlowMonitor::FlowStats &stats = Get (m_flows, Classify (header, packet));
+  if (stats.rxPackets == 0)
+    {
+      stats.timeFirstRxPacket = now;
+    }
+  else
+    {
+      Time jitter = delay - stats.lastDelay;
+      stats.jitterSum += jitter.IsNegative () ? -jitter : jitter;
+    }
+  stats.lastDelay = delay;
+  stats.delaySum += delay;
+  stats.timeLastRxPacket = now;
+  stats.rxPackets++;
+  stats.rxBytes += packet->GetSize () + header.GetSerializedSize ();
+}
+
+inline std::string
+PartitionFlowProbe::Serialize (void) const
+{
+  std::ostringstream os;
+  for (FlowMap::const_iterator i = m_flows.begin (); i != m_flows.end (); ++i)
+    {
+      const Ipv4FlowClassifier::FiveTuple &t = i->first;
+      const FlowMonitor::FlowStats &s = i->second;
+      os << t.sourceAddress.Get () << " " << t.destinationAddress.Get () << " " << uint32_t (t.protocol) << " "
+         << t.sourcePort << " " << t.destinationPort << " "
+         << s.txPackets << " " << s.txBytes << " "
+         << s.timeFirstTxPacket.GetTimeStep () << " " << s.timeLastTxPacket.GetTimeStep () << " "
+         << s.rxPackets << " " << s.rxBytes << " "
+         << s.timeFirstRxPacket.GetTimeStep () << " " << s.timeLastRxPacket.GetTimeStep () << " "
+         << s.delaySum.GetTimeStep () << " " << s.jitterSum.GetTimeStep () << "\n";
+    }
+  return os.str ();
+}
+
+inline void
+PartitionFlowProbe::Merge (const std::vector<std::string> &parts,
+                           std::map<FlowId, FlowMonitor::FlowStats> &stats,
+                           std::map<FlowId, Ipv4FlowClassifier::FiveTuple> &tuples)
+{
+  FlowMap flows;
+  for (uint32_t p = 0; p < parts.size (); ++p)
+    {
+      std::istringstream in (parts[p]);
+      uint32_t source, destination, protocol;
+      uint32_t txPackets, rxPackets;
+      uint64_t txBytes, rxBytes;
+      int64_t firstTx, lastTx, firstRx, lastRx, delaySum, jitterSum;
+      Ipv4FlowClassifier::FiveTuple t;
+      while (in >> source >> destination >> protocol >> t.sourcePort >> t.destinationPort
+                >> txPackets >> txBytes >> firstTx >> lastTx
+                >> rxPackets >> rxBytes >> firstRx >> lastRx >> delaySum >> jitterSum)
+        {
+          t.sourceAddress = Ipv4Address (source);
+          t.destinationAddress = Ipv4Address (destination);
+          t.protocol = protocol;
+          FlowMonitor::FlowStats &s = Get (flows, t);
+          // A flow is sent by one process and received by one process.
+          if (txPackets > 0)
+            {
+              s.txPackets += txPackets;
+              s.txBytes += txBytes;
+              s.timeFirstTxPacket = TimeStep (firstTx);
+              s.timeLastTxPacket = TimeStep (lastTx);
+            }
+          if (rxPackets > 0)
+            {
+              s.rxPackets += rxPackets;
+              s.rxBytes += rxBytes;
+              s.timeFirstRxPacket = TimeStep (firstRx);
+              s.timeLastRxPacket = TimeStep (lastRx);
+              s.delaySum += TimeStep (delaySum);
+              s.jitterSum += TimeStep (jitterSum);
+            }
+        }
+    }
+
+  stats.clear ();
+  tuples.clear ();
+  FlowId id = 1;
+  for (FlowMap::const_iterator i = flows.begin (); i != flows.end (); ++i, ++id)
+    {
+      tuples[id] = i->first;
+      stats[id] = i->second;
+    }
+}
+
+} // namespace ns3
+
+#endif /* PARTITION_FLOW_PROBE_H */
@@ -0,0 +1,1086 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PROCESS_PARTITION_H
+#define PROCESS_PARTITION_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include <stdint.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace ns3 {
+
+class BackboneNetDevice;
+
+/**
+ * \brief A broadcast Ethernet segment that may span several processes.
+ *
+ * Every frame sent by one of its devices is received by all the others
+ * after the transmission time at DataRate plus Delay, like on a CSMA
+ * segment without contention (the backbone of the bridged scenarios never
+ * comes close to its capacity).  Devices of other processes are reached
+ * through a ProcessPartition: the frames are kept for it and handed over at
+ * the end of every window.  Delay is the lookahead of the partition, so it
+ * must be positive when there is more than one process.
+ */
+class BackboneChannel : public Channel
+{
+public:
+  /// A frame for the devices of the other processes.
+  struct Frame
+  {
+    int64_t arrival;                //!< reception time, in time steps
+    uint16_t protocol;
+    Mac48Address to;
+    Mac48Address from;
+    Ptr<Packet> packet;
+  };
+
+  static TypeId GetTypeId (void);
+
+  BackboneChannel ();
+
+  void Add (Ptr<BackboneNetDevice> device);
+  virtual uint32_t GetNDevices (void) const;
+  virtual Ptr<NetDevice> GetDevice (uint32_t i) const;
+
+  Time GetDelay (void) const;
+  /// Time to send size bytes, with the Ethernet header and trailer.
+  Time GetTransmissionTime (uint32_t size) const;
+
+  /// Deliver a frame whose transmission by sender ends at end.
+  void Send (Ptr<BackboneNetDevice> sender, Ptr<Packet> packet, uint16_t protocol,
+             Mac48Address to, Mac48Address from, Time end);
+
+  /// Keep the frames sent from now on for the other processes.
+  void SetRemote (bool remote);
+  /// Move the frames kept for the other processes into frames.
+  void TakeOutgoing (std::vector<Frame> &frames);
+  /// Deliver a frame of another process to every device of this one.
+  void Deliver (const Frame &frame);
+
+private:
+  void Schedule (Ptr<BackboneNetDevice> device, Ptr<Packet> packet, uint16_t protocol,
+                 Mac48Address to, Mac48Address from, Time arrival);
+
+  std::vector<Ptr<BackboneNetDevice> > m_devices;
+  DataRate m_dataRate;
+  Time m_delay;
+  bool m_remote;
+  std::vector<Frame> m_outgoing;
+};
+
+/**
+ * \brief The device of a BackboneChannel: a bridgeable Ethernet port.
+ */
+class BackboneNetDevice : public NetDevice
+{
+public:
+  static TypeId GetTypeId (void);
+
+  BackboneNetDevice ();
+
+  void SetChannel (Ptr<BackboneChannel> channel);
+  /// Called by the channel when a frame arrives.
+  void Receive (Ptr<Packet> packet, uint16_t protocol, Mac48Address to, Mac48Address from);
+
+  virtual void SetIfIndex (const uint32_t index);
+  virtual uint32_t GetIfIndex (void) const;
+  virtual Ptr<Channel> GetChannel (void) const;
+  virtual void SetAddress (Address address);
+  virtual Address GetAddress (void) const;
+  virtual bool SetMtu (const uint16_t mtu);
+  virtual uint16_t GetMtu (void) const;
+  virtual bool IsLinkUp (void) const;
+  virtual void AddLinkChangeCallback (Callback<void> callback);
+  virtual bool IsBroadcast (void) const;
+  virtual Address GetBroadcast (void) const;
+  virtual bool IsMulticast (void) const;
+  virtual Address GetMulticast (Ipv4Address multicastGroup) const;
+  virtual Address GetMulticast (Ipv6Address addr) const;
+  virtual bool IsBridge (void) const;
+  virtual bool IsPointToPoint (void) const;
+  virtual bool Send (Ptr<Packet> packet, const Address &dest, uint16_t protocolNumber);
+  virtual bool SendFrom (Ptr<Packet> packet, const Address &source, const Address &dest, uint16_t protocolNumber);
+  virtual Ptr<Node> GetNode (void) const;
+  virtual void SetNode (Ptr<Node> node);
+  virtual bool NeedsArp (void) const;
+  virtual void SetReceiveCallback (NetDevice::ReceiveCallback cb);
+  virtual void SetPromiscReceiveCallback (NetDevice::PromiscReceiveCallback cb);
+  virtual bool SupportsSendFrom (void) const;
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  Ptr<BackboneChannel> m_channel;
+  Ptr<Node> m_node;
+  Mac48Address m_address;
+  uint32_t m_ifIndex;
+  uint16_t m_mtu;
+  Time m_txFree;                    //!< when the current transmission ends
+  NetDevice::ReceiveCallback m_rxCallback;
+  NetDevice::PromiscReceiveCallback m_promiscCallback;
+};
+
+/**
+ * \brief Lets ProcessPartition read the time of the earliest pending
+ * event, which the simulator keeps to itself.
+ *
+ * The events are ordered by the scheduler of the Inner attribute, which
+ * ProcessPartition::Run () sets to the scheduler selected for the
+ * simulation (SchedulerType), so a CountingScheduler or a
+ * ProfilingScheduler keeps counting.
+ */
+class PartitionScheduler : public Scheduler
+{
+public:
+  static TypeId GetTypeId (void);
+
+  PartitionScheduler ();
+  virtual ~PartitionScheduler ();
+
+  virtual void Insert (const Scheduler::Event &ev);
+  virtual bool IsEmpty (void) const;
+  virtual Scheduler::Event PeekNext (void) const;
+  virtual Scheduler::Event RemoveNext (void);
+  virtual void Remove (const Scheduler::Event &ev);
+
+  /// \return the time step of the earliest event of the simulator, or the
+  ///         largest int64_t when there is none
+  static int64_t GetNextTimeStep (void);
+
+protected:
+  virtual void NotifyConstructionCompleted (void);
+
+private:
+  /// The scheduler the simulator uses; the last one created.
+  static PartitionScheduler *& GetCurrent (void);
+
+  TypeId m_innerType;
+  Ptr<Scheduler> m_inner;
+};
+
+/**
+ * \brief Splits one simulation across local processes connected by a
+ * BackboneChannel.
+ *
+ * The constructor forks GetN () - 1 children and every process returns from
+ * it with its own rank; each then builds only the part of the topology it
+ * owns (IsLocal ()), with the nodes it does not own left out altogether, so
+ * the memory of a large model is divided between the processes.
+ *
+ * Run () advances the processes in lockstep windows as long as the channel
+ * delay, the lookahead: a frame sent during a window cannot arrive before
+ * the window ends, so each process simulates a window on its own, then
+ * sends every peer the backbone frames of the window, followed by an end
+ * marker that also serves as its null message, and waits for theirs.  The
+ * end marker carries the time of the sender's earliest pending event, so
+ * every process knows when the first event of the whole simulation is and
+ * the next window starts there instead of where the last one ended:
+ * stretches without any event, such as the time before the applications
+ * start, cost one exchange instead of one per lookahead.  The exchange runs
+ * over a mesh of Unix socket pairs created before the fork.
+ * Frames are serialized with their tags and metadata, so byte tags cross
+ * the partition.
+ *
+ * Processes do not share random streams: results are statistically, not
+ * bit for bit, the same as those of one process.
+ */
+class ProcessPartition
+{
+public:
+  /// Fork the processes; every one of them returns with its rank.
+  ProcessPartition (uint32_t nProcesses);
+  /// On rank 0, wait for the other processes.
+  ~ProcessPartition ();
+
+  uint32_t GetRank (void) const;
+  uint32_t GetN (void) const;
+  /// Whether item number i (a BSS, an AP, ...) belongs to this process.
+  bool IsLocal (uint32_t i) const;
+  /**
+   * A MAC address for device number index of item i, the same in every
+   * process.  Mac48Address::Allocate () counts the devices a process
+   * creates, so the processes would hand out the same addresses.
+   */
+  static Mac48Address MakeAddress (uint32_t i, uint32_t index);
+
+  void SetChannel (Ptr<BackboneChannel> channel);
+  /// Simulate until stop, synchronized with the other processes.
+  void Run (Time stop);
+  /// Windows simulated by Run ().
+  uint64_t GetWindows (void) const;
+
+  /**
+   * Collect a string from every process.  Rank 0 gets them all, in rank
+   * order; the other ranks get an empty vector.
+   */
+  std::vector<std::string> Gather (const std::string &local);
+  /// On ranks other than 0, flush the output and exit.
+  void ExitIfChild (void);
+
+private:
+  /**
+   * Frame record on the sockets; size 0 ends a window, and its arrival is
+   * then the time step of the sender's earliest event.
+   */
+  struct Record
+  {
+    int64_t arrival;
+    uint32_t size;
+    uint16_t protocol;
+    uint8_t to[6];
+    uint8_t from[6];
+    uint8_t padding[6];
+  };
+
+  /**
+   * Send the frames of the window and the time step of the next local
+   * event, receive those of the other processes.
+   * \return the time step of the earliest event of all the processes
+   */
+  int64_t Exchange (int64_t next);
+  void Write (int fd, const std::string &data);
+  void Read (int fd, char *data, size_t size);
+
+  uint32_t m_n;
+  uint32_t m_rank;
+  std::vector<int> m_peers;          //!< socket to every rank, -1 for this one
+  std::vector<pid_t> m_children;
+  Ptr<BackboneChannel> m_channel;
+  uint64_t m_windows;
+};
+
+NS_OBJECT_ENSURE_REGISTERED (PartitionScheduler);
+NS_OBJECT_ENSURE_REGISTERED (BackboneChannel);
+NS_OBJECT_ENSURE_REGISTERED (BackboneNetDevice);
+
+inline TypeId
+PartitionScheduler::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::PartitionScheduler")
+    .SetParent<Scheduler> ()
+    .SetGroupName ("Core")
+    .AddConstructor<PartitionScheduler> ()
+    .AddAttribute ("Inner", "The scheduler that orders the events.",
+                   TypeIdValue (MapScheduler::GetTypeId ()),
+                   MakeTypeIdAccessor (&PartitionScheduler::m_innerType),
+                   MakeTypeIdChecker ())
+  ;
+  return tid;
+}
+
+inline
+PartitionScheduler::PartitionScheduler ()
+{
+  GetCurrent () = this;
+}
+
+inline
+PartitionScheduler::~PartitionScheduler ()
+{
+  if (GetCurrent () == this)
+    {
+      GetCurrent () = 0;
+    }
+}
+
+inline void
+PartitionScheduler::NotifyConstructionCompleted (void)
+{
+  Scheduler::NotifyConstructionCompleted ();
+  ObjectFactory factory;
+  factory.SetTypeId (m_innerType);
+  m_inner = factory.Create<Scheduler> ();
+}
+
+inline void
+PartitionScheduler::Insert (const Scheduler::Event &ev)
+{
+  m_inner->Insert (ev);
+}
+
+inline bool
+PartitionScheduler::IsEmpty (void) const
+{
+  return m_inner->IsEmpty ();
+}
+
+inline Scheduler::Event
+PartitionScheduler::PeekNext (void) const
+{
+  return m_inner->PeekNext ();
+}
+
+inline Scheduler::Event
+PartitionScheduler::RemoveNext (void)
+{
+  return m_inner->RemoveNext ();
+}
+
+inline void
+PartitionScheduler::Remove (const Scheduler::Event &ev)
+{
+  m_inner->Remove (ev);
+}
+
+inline PartitionScheduler *&
+PartitionScheduler::GetCurrent (void)
+{
+  static PartitionScheduler *current = 0;
+  return current;
+}
+
+inline int64_t
+PartitionScheduler::GetNextTimeStep (void)
+{
+  PartitionScheduler *current = GetCurrent ();
+  if (current == 0 || current->IsEmpty ())
+    {
+      return std::numeric_limits<int64_t>::max ();
+    }
+  return current->PeekNext ().key.m_ts;
+}
+
+inline TypeId
+BackboneChannel::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::BackboneChannel")
+    .SetParent<Channel> ()
+    .SetGroupName ("Bridge")
+    .AddConstructor<BackboneChannel> ()
+    .AddAttribute ("DataRate", "The rate of every device of the segment.",
+                   DataRateValue (DataRate ("100Mbps")),
+                   MakeDataRateAccessor (&BackboneChannel::m_dataRate),
+                   MakeDataRateChecker ())
+    .AddAttribute ("Delay", "The propagation delay, and the lookahead of a partition.",
+                   TimeValue (MicroSeconds (50)),
+                   MakeTimeAccessor (&BackboneChannel::m_delay),
+                   MakeTimeChecker ())
+  ;
+  return tid;
+}
+
+inline
+BackboneChannel::BackboneChannel ()
+  : m_remote (false)
+{
+}
+
+inline void
+BackboneChannel::Add (Ptr<BackboneNetDevice> device)
+{
+  m_devices.push_back (device);
+}
+
+inline uint32_t
+BackboneChannel::GetNDevices (void) const
+{
+  return m_devices.size ();
+}
+
+inline Ptr<NetDevice>
+BackboneChannel::GetDevice (uint32_t i) const
+{
+  return m_devices[i];
+}
+
+inline Time
+BackboneChannel::GetDelay (void) const
+{
+  return m_delay;
+}
+
+inline Time
+BackboneChannel::GetTransmissionTime (uint32_t size) const
+{
+  return m_dataRate.CalculateBytesTxTime (size + 18);
+}
+
+inline void
+BackboneChannel::Schedule (Ptr<BackboneNetDevice> device, Ptr<Packet> packet, uint16_t protocol,
+                           Mac48Address to, Mac48Address from, Time arrival)
+{
+  Simulator::ScheduleWithContext (device->GetNode ()->GetId (), arrival - Simulator::Now (),
+                                  &BackboneNetDevice::Receive, device, packet->Copy (), protocol, to, from);
+}
+
+inline void
+BackboneChannel::Send (Ptr<BackboneNetDevice> sender, Ptr<Packet> packet, uint16_t protocol,
+                       Mac48Address to, Mac48Address from, Time end)
+{
+  Time arrival = end + m_delay;
+  for (uint32_t i = 0; i < m_devices.size (); ++i)
+    {
+      if (m_devices[i] != sender)
+        {
+          Schedule (m_devices[i], packet, protocol, to, from, arrival);
+        }
+    }
+  if (m_remote)
+    {
+      Frame frame;
+      frame.arrival = arrival.GetTimeStep ();
+      frame.protocol = protocol;
+      frame.to = to;
+      frame.from = from;
+      frame.packet = packet->Copy ();
+      m_outgoing.push_back (frame);
+    }
+}
+
+inline void
+BackboneChannel::SetRemote (bool remote)
+{
+  m_remote = remote;
+}
+
+inline void
+BackboneChannel::TakeOutgoing (std::vector<Frame> &frames)
+{
+  frames.clear ();
+  frames.swap (m_outgoing);
+}
+
+inline void
+BackboneChannel::Deliver (const Frame &frame)
+{
+  for (uint32_t i = 0; i < m_devices.size (); ++i)
+    {
+      Schedule (m_devices[i], frame.packet, frame.protocol, frame.to, frame.from, TimeStep (frame.arrival));
+    }
+}
+
+inline TypeId
+BackboneNetDevice::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::BackboneNetDevice")
+    .SetParent<NetDevice> ()
+    .SetGroupName ("Bridge")
+    .AddConstructor<BackboneNetDevice> ()
+  ;
+  return tid;
+}
+
+inline
+BackboneNetDevice::BackboneNetDevice ()
+  : m_ifIndex (0),
+    m_mtu (1500),
+    m_txFree (Seconds (0))
+{
+}
+
+inline void
+BackboneNetDevice::SetChannel (Ptr<BackboneChannel> channel)
+{
+  m_channel = channel;
+  channel->Add (this);
+}
+
+inline void
+BackboneNetDevice::Receive (Ptr<Packet> packet, uint16_t protocol, Mac48Address to, Mac48Address from)
+{
+  NetDevice::PacketType type;
+  if (to == m_address)
+    {
+      type = NetDevice::PACKET_HOST;
+    }
+  else if (to.IsBroadcast ())
+    {
+      type = NetDevice::PACKET_BROADCAST;
+    }
+  else if (to.IsGroup ())
+    {
+      type = NetDevice::PACKET_MULTICAST;
+    }
+  else
+    {
+      type = NetDevice::PACKET_OTHERHOST;
+    }
+  if (!m_promiscCallback.IsNull ())
+    {
+      m_promiscCallback (this, packet, protocol, from, to, type);
+    }
+  if (type != NetDevice::PACKET_OTHERHOST && !m_rxCallback.IsNull ())
+    {
+      m_rxCallback (this, packet, protocol, from);
+    }
+}
+
+inline void
+BackboneNetDevice::SetIfIndex (const uint32_t index)
+{
+  m_ifIndex = index;
+}
+
+inline uint32_t
+BackboneNetDevice::GetIfIndex (void) const
+{
+  return m_ifIndex;
+}
+
+inline Ptr<Channel>
+BackboneNetDevice::GetChannel (void) const
+{
+  return m_channel;
+}
+
+inline void
+BackboneNetDevice::SetAddress (Address address)
+{
+  m_address = Mac48Address::ConvertFrom (address);
+}
+
+inline Address
+BackboneNetDevice::GetAddress (void) const
+{
+  return m_address;
+}
+
+inline bool
+BackboneNetDevice::SetMtu (const uint16_t mtu)
+{
+  m_mtu = mtu;
+  return true;
+}
+
+inline uint16_t
+BackboneNetDevice::GetMtu (void) const
+{
+  return m_mtu;
+}
+
+inline bool
+BackboneNetDevice::IsLinkUp (void) const
+{
+  return true;
+}
+
+inline void
+BackboneNetDevice::AddLinkChangeCallback (Callback<void> callback)
+{
+}
+
+inline bool
+BackboneNetDevice::IsBroadcast (void) const
+{
+  return true;
+}
+
+inline Address
+BackboneNetDevice::GetBroadcast (void) const
+{
+  return Mac48Address::GetBroadcast ();
+}
+
+inline bool
+BackboneNetDevice::IsMulticast (void) const
+{
+  return true;
+}
+
+inline Address
+BackboneNetDevice::GetMulticast (Ipv4Address multicastGroup) const
+{
+  return Mac48Address::GetMulticast (multicastGroup);
+}
+
+inline Address
+BackboneNetDevice::GetMulticast (Ipv6Address addr) const
+{
+  return Mac48Address::GetMulticast (addr);
+}
+
+inline bool
+BackboneNetDevice::IsBridge (void) const
+{
+  return false;
+}
+
+inline bool
+BackboneNetDevice::IsPointToPoint (void) const
+{
+  return false;
+}
+
+inline bool
+BackboneNetDevice::Send (Ptr<Packet> packet, const Address &dest, uint16_t protocolNumber)
+{
+  return SendFrom (packet, m_address, dest, protocolNumber);
+}
+
+inline bool
+BackboneNetDevice::SendFrom (Ptr<Packet> packet, const Address &source, const Address &dest, uint16_t protocolNumber)
+{
+  NS_ASSERT (m_channel != 0);
+  // Frames queue behind the one being sent.
+  Time start = Max (Simulator::Now (), m_txFree);
+  m_txFree = start + m_channel->GetTransmissionTime (packet->GetSize ());
+  m_channel->Send (this, packet, protocolNumber, Mac48Address::ConvertFrom (dest),
+                   Mac48Address::ConvertFrom (source), m_txFree);
+  return true;
+}
+
+inline Ptr<Node>
+BackboneNetDevice::GetNode (void) const
+{
+  return m_node;
+}
+
+inline void
+BackboneNetDevice::SetNode (Ptr<Node> node)
+{
+  m_node = node;
+}
+
+inline bool
+BackboneNetDevice::NeedsArp (void) const
+{
+  return true;
+}
+
+inline void
+BackboneNetDevice::SetReceiveCallback (NetDevice::ReceiveCallback cb)
+{
+  m_rxCallback = cb;
+}
+
+inline void
+BackboneNetDevice::SetPromiscReceiveCallback (NetDevice::PromiscReceiveCallback cb)
+{
+  m_promiscCallback = cb;
+}
+
+inline bool
+BackboneNetDevice::SupportsSendFrom (void) const
+{
+  return true;
+}
+
+inline void
+BackboneNetDevice::DoDispose (void)
+{
+  m_channel = 0;
+  m_node = 0;
+  m_rxCallback.Nullify ();
+  m_promiscCallback.Nullify ();
+  NetDevice::DoDispose ();
+}
+
+inline
+ProcessPartition::ProcessPartition (uint32_t nProcesses)
+  : m_n (std::max<uint32_t> (nProcesses, 1)),
+    m_rank (0),
+    m_windows (0)
+{
+  std::vector<std::vector<int> > sockets (m_n, std::vector<int> (m_n, -1));
+  for (uint32_t i = 0; i < m_n; ++i)
+    {
+      for (uint32_t j = i + 1; j < m_n; ++j)
+        {
+          int pair[2];
+          if (socketpair (AF_UNIX, SOCK_STREAM, 0, pair) != 0)
+            {
+              NS_FATAL_ERROR ("ProcessPartition: socketpair () failed: " << std::strerror (errno));
+            }
+          sockets[i][j] = pair[0];
+          sockets[j][i] = pair[1];
+        }
+    }
+
+  // Anything still buffered would otherwise be printed once by every child.
+  std::cout.flush ();
+  std::cerr.flush ();
+  std::fflush (0);
+
+  for (uint32_t rank = 1; rank < m_n; ++rank)
+    {
+      pid_t pid = fork ();
+      if (pid < 0)
+        {
+          NS_FATAL_ERROR ("ProcessPartition: fork () failed: " << std::strerror (errno));
+        }
+      if (pid == 0)
+        {
+          m_rank = rank;
+          m_children.clear ();
+          break;
+        }
+      m_children.push_back (pid);
+    }
+
+  for (uint32_t i = 0; i < m_n; ++i)
+    {
+      for (uint32_t j = 0; j < m_n; ++j)
+        {
+          if (i != m_rank && sockets[i][j] >= 0)
+            {
+              close (sockets[i][j]);
+            }
+        }
+    }
+  m_peers = sockets[m_rank];
+  for (uint32_t i = 0; i < m_n; ++i)
+    {
+      if (m_peers[i] >= 0)
+        {
+          fcntl (m_peers[i], F_SETFL, fcntl (m_peers[i], F_GETFL) | O_NONBLOCK);
+        }
+    }
+}
+
+inline
+ProcessPartition::~ProcessPartition ()
+{
+  for (uint32_t i = 0; i < m_n; ++i)
+    {
+      if (m_peers[i] >= 0)
+        {
+          close (m_peers[i]);
+        }
+    }
+  for (uint32_t i = 0; i < m_children.size (); ++i)
+    {
+      int status = 0;
+      while (waitpid (m_children[i], &status, 0) < 0)
+        {
+          if (errno != EINTR)
+            {
+              NS_FATAL_ERROR ("ProcessPartition: waitpid () failed: " << std::strerror (errno));
+            }
+        }
+      if (!WIFEXITED (status) || WEXITSTATUS (status) != 0)
+        {
+          NS_FATAL_ERROR ("ProcessPartition: rank " << i + 1 << " (pid " << m_children[i] << ") failed");
+        }
+    }
+}
+
+inline uint32_t
+ProcessPartition::GetRank (void) const
+{
+  return m_rank;
+}
+
+inline uint32_t
+ProcessPartition::GetN (void) const
+{
+  return m_n;
+}
+
+inline bool
+ProcessPartition::IsLocal (uint32_t i) const
+{
+  return i % m_n == m_rank;
+}
+
+inline Mac48Address
+ProcessPartition::MakeAddress (uint32_t i, uint32_t index)
+{
+  // Locally administered, so apart from the allocated ones.
+  uint8_t buffer[6] = { 0x02, 0, uint8_t (i >> 8), uint8_t (i), uint8_t (index >> 8), uint8_t (index) };
+  Mac48Address address;
+  address.CopyFrom (buffer);
+  return address;
+}
+
+inline void
+ProcessPartition::SetChannel (Ptr<BackboneChannel> channel)
+{
+  m_channel = channel;
+  m_channel->SetRemote (m_n > 1);
+}
+
+inline uint64_t
+ProcessPartition::GetWindows (void) const
+{
+  return m_windows;
+}
+
+inline void
+ProcessPartition::Run (Time stop)
+{
+  if (m_n == 1)
+    {
+      Simulator::Stop (stop - Simulator::Now ());
+      Simulator::Run ();
+      return;
+    }
+  NS_ABORT_MSG_IF (m_channel == 0, "ProcessPartition::Run needs the backbone channel");
+  Time lookahead = m_channel->GetDelay ();
+  NS_ABORT_MSG_IF (!lookahead.IsStrictlyPositive (), "ProcessPartition: the backbone delay must be positive");
+  // Wrap the scheduler selected for the simulation rather than replace it.
+  StringValue selected;
+  GlobalValue::GetValueByName ("SchedulerType", selected);
+  ObjectFactory scheduler;
+  scheduler.SetTypeId ("ns3::PartitionScheduler");
+  scheduler.Set ("Inner", TypeIdValue (TypeId::LookupByName (selected.Get ())));
+  Simulator::SetScheduler (scheduler);
+  // Every process computes the same window ends, so they stay in step.  No
+  // process has an event before next, so the window starts there.
+  int64_t next = Simulator::Now ().GetTimeStep ();
+  while (Simulator::Now () < stop)
+    {
+      Time end = next < (stop - lookahead).GetTimeStep () ? TimeStep (next) + lookahead : stop;
+      Simulator::Stop (end - Simulator::Now ());
+      Simulator::Run ();
+      next = Exchange (PartitionScheduler::GetNextTimeStep ());
+      m_windows++;
+    }
+}
+
+inline int64_t
+ProcessPartition::Exchange (int64_t next)
+{
+  std::vector<BackboneChannel::Frame> frames;
+  m_channel->TakeOutgoing (frames);
+  std::string out;
+  for (uint32_t i = 0; i < frames.size (); ++i)
+    {
+      next = std::min (next, frames[i].arrival);
+      Record record;
+      std::memset (&record, 0, sizeof (record));
+      record.arrival = frames[i].arrival;
+      record.size = frames[i].packet->GetSerializedSize ();
+      record.protocol = frames[i].protocol;
+      frames[i].to.CopyTo (record.to);
+      frames[i].from.CopyTo (record.from);
+      std::string data (record.size, '\0');
+      frames[i].packet->Serialize (reinterpret_cast<uint8_t *> (&data[0]), record.size);
+      out.append (reinterpret_cast<const char *> (&record), sizeof (record));
+      out.append (data);
+    }
+  Record end;
+  std::memset (&end, 0, sizeof (end));
+  end.arrival = next;
+  out.append (reinterpret_cast<const char *> (&end), sizeof (end));
+
+  // Write to every peer while reading from all of them: a peer whose socket
+  // is full may be waiting for us to read before it reads in turn.
+  std::vector<size_t> written (m_n, 0);
+  std::vector<std::string> in (m_n);
+  std::vector<size_t> parsed (m_n, 0);
+  std::vector<bool> finished (m_n, false);
+  std::vector<std::vector<BackboneChannel::Frame> > received (m_n);
+  char buffer[65536];
+  while (true)
+    {
+      std::vector<struct pollfd> fds;
+      std::vector<uint32_t> ranks;
+      for (uint32_t i = 0; i < m_n; ++i)
+        {
+          if (i == m_rank)
+            {
+              continue;
+            }
+          short events = (written[i] < out.size () ? POLLOUT : 0) | (finished[i] ? 0 : POLLIN);
+          if (events != 0)
+            {
+              struct pollfd fd;
+              fd.fd = m_peers[i];
+              fd.events = events;
+              fd.revents = 0;
+              fds.push_back (fd);
+              ranks.push_back (i);
+            }
+        }
+      if (fds.empty ())
+        {
+          break;
+        }
+      if (poll (&fds[0], fds.size (), -1) < 0)
+        {
+          if (errno == EINTR)
+            {
+              continue;
+            }
+          NS_FATAL_ERROR ("ProcessPartition: poll () failed: " << std::strerror (errno));
+        }
+      for (uint32_t k = 0; k < fds.size (); ++k)
+        {
+          uint32_t i = ranks[k];
+          if (fds[k].revents & POLLOUT)
+            {
+              ssize_t n = write (m_peers[i], out.data () + written[i], out.size () - written[i]);
+              if (n > 0)
+                {
+                  written[i] += n;
+                }
+              else if (n < 0 && errno != EAGAIN && errno != EINTR)
+                {
+                  NS_FATAL_ERROR ("ProcessPartition: write to rank " << i << " failed: " << std::strerror (errno));
+                }
+            }
+          if (fds[k].revents & (POLLIN | POLLHUP | POLLERR))
+            {
+              ssize_t n = read (m_peers[i], buffer, sizeof (buffer));
+              if (n == 0)
+                {
+                  NS_FATAL_ERROR ("ProcessPartition: rank " << i << " exited during the simulation");
+                }
+              if (n < 0)
+                {
+                  if (errno != EAGAIN && errno != EINTR)
+                    {
+                      NS_FATAL_ERROR ("ProcessPartition: read from rank " << i << " failed: " << std::strerror (errno));
+                    }
+                  continue;
+                }
+              in[i].append (buffer, n);
+              Record record;
+              while (!finished[i] && in[i].size () - parsed[i] >= sizeof (record))
+                {
+                  std::memcpy (&record, in[i].data () + parsed[i], sizeof (record));
+                  if (record.size == 0)
+                    {
+                      next = std::min (next, record.arrival);
+                      finished[i] = true;
+                      parsed[i] += sizeof (record);
+                      break;
+                    }
+                  if (in[i].size () - parsed[i] < sizeof (record) + record.size)
+                    {
+                      break;
+                    }
+                  BackboneChannel::Frame frame;
+                  frame.arrival = record.arrival;
+                  frame.protocol = record.protocol;
+                  frame.to.CopyFrom (record.to);
+                  frame.from.CopyFrom (record.from);
+                  frame.packet = Create<Packet> (reinterpret_cast<const uint8_t *> (in[i].data () + parsed[i] + sizeof (record)),
+                                                 record.size, true);
+                  received[i].push_back (frame);
+                  parsed[i] += sizeof (record) + record.size;
+                }
+            }
+        }
+    }
+
+  // Schedule in rank order, whatever order the data came in, so that a run
+  // is reproducible.
+  for (uint32_t i = 0; i < m_n; ++i)
+    {
+      NS_ABORT_MSG_IF (parsed[i] != in[i].size (), "ProcessPartition: rank " << i << " sent past the end of its window");
+      for (uint32_t k = 0; k < received[i].size (); ++k)
+        {
+          m_channel->Deliver (received[i][k]);
+        }
+    }
+  return next;
+}
+
+inline void
+ProcessPartition::Write (int fd, const std::string &data)
+{
+  size_t done = 0;
+  while (done < data.size ())
+    {
+      ssize_t n = write (fd, data.data () + done, data.size () - done);
+      if (n > 0)
+        {
+          done += n;
+        }
+      else if (n < 0 && (errno == EAGAIN || errno == EINTR))
+        {
+          struct pollfd pfd = { fd, POLLOUT, 0 };
+          poll (&pfd, 1, -1);
+        }
+      else
+        {
+          NS_FATAL_ERROR ("ProcessPartition: write failed: " << std::strerror (errno));
+        }
+    }
+}
+
+inline void
+ProcessPartition::Read (int fd, char *data, size_t size)
+{
+  size_t done = 0;
+  while (done < size)
+    {
+      ssize_t n = read (fd, data + done, size - done);
+      if (n > 0)
+        {
+          done += n;
+        }
+      else if (n < 0 && (errno == EAGAIN || errno == EINTR))
+        {
+          struct pollfd pfd = { fd, POLLIN, 0 };
+          poll (&pfd, 1, -1);
+        }
+      else
+        {
+          NS_FATAL_ERROR ("ProcessPartition: read failed: " << (n == 0 ? "peer exited" : std::strerror (errno)));
+        }
+    }
+}
+
+inline std::vector<std::string>
+ProcessPartition::Gather (const std::string &local)
+{
+  std::vector<std::string> all;
+  if (m_rank != 0)
+    {
+      uint32_t size = local.size ();
+      Write (m_peers[0], std::string (reinterpret_cast<const char *> (&size), sizeof (size)) + local);
+      return all;
+    }
+  all.push_back (local);
+  for (uint32_t i = 1; i < m_n; ++i)
+    {
+      uint32_t size;
+      Read (m_peers[i], reinterpret_cast<char *> (&size), sizeof (size));
+      std::string data (size, '\0');
+      if (size > 0)
+        {
+          Read (m_peers[i], &data[0], size);
+        }
+      all.push_back (data);
+    }
+  return all;
+}
+
+inline void
+ProcessPartition::ExitIfChild (void)
+{
+  if (m_rank == 0)
+    {
+      return;
+    }
+  std::cout.flush ();
+  std::cerr.flush ();
+  std::fflush (0);
+  _exit (0);
+}
+
+} // namespace ns3
+
+#endif /* PROCESS_PARTITION_H */
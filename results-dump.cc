@@ -0,0 +1,163 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * Prints a columnar results file (see results-store.h) as CSV.
+ *
+ * By default one line per row group with its scalars, i.e. the old
+ * report.csv; --group=N prints the per-flow table of row group N instead.
+ *
+ *   ./waf --run "code --output=columnar"
+ *   ./waf --run "results-dump --file=report.wres"
+ *   ./waf --run "results-dump --file=report.wres --group=3"
+ *   ./waf --run "results-dump --selfTest"
+ */
+
+#include "ns3/core-module.h"
+#include "results-store.h"
+#include <iostream>
+
+using namespace ns3;
+
+/*
+ * A row group whose counts claim more data than it holds, with a body of
+ * body bytes after them.
+ */
+static std::string
+MakeGroup (uint32_t rows, uint32_t nColumns, uint32_t body)
+{
+  std::string group;
+  results::PutU32 (group, results::g_groupMagic);
+  results::PutU32 (group, 12 + body);
+  results::PutU32 (group, 0);
+  results::PutU32 (group, rows);
+  results::PutU32 (group, nColumns);
+  group.append (body, '\0');
+  return group;
+}
+
+/* Checks that well-formed groups load and malformed ones are rejected. */
+static int
+SelfTest (void)
+{
+  int failures = 0;
+
+  ResultsRowGroup good;
+  good.SetMeta ("load", 0.5);
+  uint32_t column = good.AddColumn ("tput");
+  good.Append (column, 1.0);
+  good.Append (column, 2.0);
+  std::string data = good.Serialize ();
+  ResultsRowGroup parsed;
+  if (parsed.Deserialize (data.data (), data.size ()) != data.size ()
+      || parsed.GetNRows () != 2 || parsed.GetColumn (0)[1] != 2.0)
+    {
+      std::cerr << "selfTest: a valid group did not round-trip\n";
+      failures++;
+    }
+
+  struct Case
+  {
+    const char *name;
+    std::string data;
+  };
+  Case cases[] = {
+    { "rows * columns wrapping to 0", MakeGroup (1u << 31, 1u << 30, 64) },
+    { "rows beyond the data", MakeGroup (1000, 1, 64) },
+    { "columns beyond the data", MakeGroup (0, 0xffffffff, 64) },
+    { "truncated group", data.substr (0, data.size () - 1) },
+  };
+  for (uint32_t i = 0; i < sizeof (cases) / sizeof (cases[0]); ++i)
+    {
+      ResultsRowGroup group;
+      if (group.Deserialize (cases[i].data.data (), cases[i].data.size ()) != 0)
+        {
+          std::cerr << "selfTest: accepted a malformed group: " << cases[i].name << "\n";
+          failures++;
+        }
+    }
+  std::cout << (failures == 0 ? "selfTest: ok" : "selfTest: FAILED") << "\n";
+  return failures == 0 ? 0 : 1;
+}
+
+int
+main (int argc, char *argv[])
+{
+  std::string file = "report.wres";
+  int32_t groupIndex = -1;
+  bool selfTest = false;
+
+  CommandLine cmd;
+  cmd.AddValue ("file", "Columnar results file to read", file);
+  cmd.AddValue ("group", "Row group whose columns are printed (-1: scalars of every group)", groupIndex);
+  cmd.AddValue ("selfTest", "Check the parser against malformed row groups and exit", selfTest);
+  cmd.Parse (argc, argv);
+
+  if (selfTest)
+    {
+      return SelfTest ();
+    }
+
+  std::vector<ResultsRowGroup> groups = ResultsFile::Load (file);
+
+  if (groupIndex < 0)
+    {
+      if (groups.empty ())
+        {
+          return 0;
+        }
+      const std::vector<std::string> &names = groups[0].GetMetaNames ();
+      std::cout << "group";
+      for (uint32_t i = 0; i < names.size (); ++i)
+        {
+          std::cout << "," << names[i];
+        }
+      std::cout << "\n";
+      for (uint32_t g = 0; g < groups.size (); ++g)
+        {
+          std::cout << g;
+          for (uint32_t i = 0; i < names.size (); ++i)
+            {
+              std::cout << ",";
+              if (groups[g].HasMeta (names[i]))
+                {
+                  std::cout << groups[g].GetMeta (names[i]);
+                }
+            }
+          std::cout << "\n";
+        }
+      return 0;
+    }
+
+  NS_ABORT_MSG_IF ((uint32_t) groupIndex >= groups.size (),
+                   file << " has " << groups.size () << " row groups, no group " << groupIndex);
+  const ResultsRowGroup &group = groups[groupIndex];
+
+  for (uint32_t c = 0; c < group.GetNColumns (); ++c)
+    {
+      std::cout << (c > 0 ? "," : "") << group.GetColumnName (c);
+    }
+  std::cout << "\n";
+  for (uint32_t r = 0; r < group.GetNRows (); ++r)
+    {
+      for (uint32_t c = 0; c < group.GetNColumns (); ++c)
+        {
+          std::cout << (c > 0 ? "," : "") << group.GetColumn (c)[r];
+        }
+      std::cout << "\n";
+    }
+  return 0;
+}
@@ -0,0 +1,446 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef RESULTS_STORE_H
+#define RESULTS_STORE_H
+
+#include "ns3/core-module.h"
+#include <stdint.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief One row group of a columnar results file.
+ *
+ * A row group holds the results of one simulation (typically one load point
+ * of a sweep): a list of named scalars describing the run and its summary
+ * KPIs, and a table of named double columns, e.g. one row per flow.
+ *
+ * Serialized layout, in host byte order:
+ * \verbatim
+     uint32 'RGRP'   uint32 size of the rest of the group
+     uint32 nMeta    nMeta x { uint16 nameLength, name, double value }
+     uint32 nRows    uint32 nColumns
+     nColumns x { uint16 nameLength, name, nRows x double }
+   \endverbatim
+ */
+class ResultsRowGroup
+{
+public:
+  /// Set (or overwrite) a named scalar.
+  void SetMeta (const std::string &name, double value);
+  /// \return whether the named scalar exists
+  bool HasMeta (const std::string &name) const;
+  /// \return the named scalar; aborts if it does not exist
+  double GetMeta (const std::string &name) const;
+  /// \return the scalar names, in insertion order
+  const std::vector<std::string> & GetMetaNames (void) const;
+
+  /**
+   * Add an empty column.
+   * \return the column index
+   */
+  uint32_t AddColumn (const std::string &name);
+  /// Append a value to a column.
+  void Append (uint32_t column, double value);
+
+  uint32_t GetNColumns (void) const;
+  /// \return the number of rows, i.e. the length of the shortest column
+  uint32_t GetNRows (void) const;
+  const std::string & GetColumnName (uint32_t column) const;
+  /// \return the column's values
+  const std::vector<double> & GetColumn (uint32_t column) const;
+  /// \return the index of the named column, or -1
+  int32_t FindColumn (const std::string &name) const;
+
+  /// \return the group in its on-disk form
+  std::string Serialize (void) const;
+  /**
+   * Parse a group from its on-disk form.
+   * \param data start of the group
+   * \param size bytes available
+   * \return the number of bytes consumed, 0 on a malformed group
+   */
+  uint32_t Deserialize (const char *data, uint32_t size);
+
+private:
+  std::vector<std::string> m_metaNames;
+  std::vector<double> m_metaValues;
+  std::vector<std::string> m_columnNames;
+  std::vector<std::vector<double> > m_columns;
+};
+
+/**
+ * \brief Append-only file of ResultsRowGroup.
+ *
+ * The file starts with an 8-byte magic, "WIFIRES1", followed by the row
+ * groups.  Writers only ever append, so several sweeps can share a file, and
+ * a reader loads the whole file with one read and a linear scan.
+ */
+class ResultsFile
+{
+public:
+  /// Append one serialized row group, writing the file header if needed.
+  static void Append (const std::string &path, const std::string &rowGroup);
+  /// Load every row group of a file.
+  static std::vector<ResultsRowGroup> Load (const std::string &path);
+};
+
+namespace results {
+
+static const char g_fileMagic[8] = { 'W', 'I', 'F', 'I', 'R', 'E', 'S', '1' };
+static const uint32_t g_groupMagic = 0x50524752; // "RGRP"
+
+inline void
+Put (std::string &out, const void *data, size_t size)
+{
+  out.append (static_cast<const char *> (data), size);
+}
+
+inline void
+PutU32 (std::string &out, uint32_t v)
+{
+  Put (out, &v, sizeof (v));
+}
+
+inline void
+PutName (std::string &out, const std::string &name)
+{
+  uint16_t length = name.size ();
+  Put (out, &length, sizeof (length));
+  out.append (name);
+}
+
+/// Bounds-checked cursor over a serialized row group.
+class Reader
+{
+public:
+  Reader (const char *data, uint32_t size)
+    : m_data (data), m_size (size), m_pos (0), m_ok (true)
+  {
+  }
+  bool Get (void *out, uint32_t size)
+  {
+    if (!m_ok || m_size - m_pos < size)
+      {
+        m_ok = false;
+        return false;
+      }
+    std::memcpy (out, m_data + m_pos, size);
+    m_pos += size;
+    return true;
+  }
+  uint32_t GetU32 (void)
+  {
+    uint32_t v = 0;
+    Get (&v, sizeof (v));
+    return v;
+  }
+  std::string GetName (void)
+  {
+    uint16_t length = 0;
+    Get (&length, sizeof (length));
+    if (!m_ok || m_size - m_pos < length)
+      {
+        m_ok = false;
+        return std::string ();
+      }
+    std::string name (m_data + m_pos, length);
+    m_pos += length;
+    return name;
+  }
+  bool IsOk (void) const
+  {
+    return m_ok;
+  }
+  uint32_t GetPos (void) const
+  {
+    return m_pos;
+  }
+  uint32_t GetRemaining (void) const
+  {
+    return m_size - m_pos;
+  }
+
+private:
+  const char *m_data;
+  uint32_t m_size;
+  uint32_t m_pos;
+  bool m_ok;
+};
+
+} // namespace results
+
+inline void
+ResultsRowGroup::SetMeta (const std::string &name, double value)
+{
+  for (size_t i = 0; i < m_metaNames.size (); ++i)
+    {
+      if (m_metaNames[i] == name)
+        {
+          m_metaValues[i] = value;
+          return;
+        }
+    }
+  m_metaNames.push_back (name);
+  m_metaValues.push_back (value);
+}
+
+inline bool
+ResultsRowGroup::HasMeta (const std::string &name) const
+{
+  for (size_t i = 0; i < m_metaNames.size (); ++i)
+    {
+      if (m_metaNames[i] == name)
+        {
+          return true;
+        }
+    }
+  return false;
+}
+
+inline double
+ResultsRowGroup::GetMeta (const std::string &name) const
+{
+  for (size_t i = 0; i < m_metaNames.size (); ++i)
+    {
+      if (m_metaNames[i] == name)
+        {
+          return m_metaValues[i];
+        }
+    }
+  NS_FATAL_ERROR ("ResultsRowGroup: no scalar named " << name);
+  return 0;
+}
+
+inline const std::vector<std::string> &
+ResultsRowGroup::GetMetaNames (void) const
+{
+  return m_metaNames;
+}
+
+inline uint32_t
+ResultsRowGroup::AddColumn (const std::string &name)
+{
+  m_columnNames.push_back (name);
+  m_columns.push_back (std::vector<double> ());
+  return m_columns.size () - 1;
+}
+
+inline void
+ResultsRowGroup::Append (uint32_t column, double value)
+{
+  NS_ASSERT (column < m_columns.size ());
+  m_columns[column].push_back (value);
+}
+
+inline uint32_t
+ResultsRowGroup::GetNColumns (void) const
+{
+  return m_columns.size ();
+}
+
+inline uint32_t
+ResultsRowGroup::GetNRows (void) const
+{
+  if (m_columns.empty ())
+    {
+      return 0;
+    }
+  size_t rows = m_columns[0].size ();
+  for (size_t i = 1; i < m_columns.size (); ++i)
+    {
+      rows = std::min (rows, m_columns[i].size ());
+    }
+  return rows;
+}
+
+inline const std::string &
+ResultsRowGroup::GetColumnName (uint32_t column) const
+{
+  NS_ASSERT (column < m_columnNames.size ());
+  return m_columnNames[column];
+}
+
+inline const std::vector<double> &
+ResultsRowGroup::GetColumn (uint32_t column) const
+{
+  NS_ASSERT (column < m_columns.size ());
+  return m_columns[column];
+}
+
+inline int32_t
+ResultsRowGroup::FindColumn (const std::string &name) const
+{
+  for (size_t i = 0; i < m_columnNames.size (); ++i)
+    {
+      if (m_columnNames[i] == name)
+        {
+          return i;
+        }
+    }
+  return -1;
+}
+
+inline std::string
+ResultsRowGroup::Serialize (void) const
+{
+  std::string body;
+  results::PutU32 (body, m_metaNames.size ());
+  for (size_t i = 0; i < m_metaNames.size (); ++i)
+    {
+      results::PutName (body, m_metaNames[i]);
+      results::Put (body, &m_metaValues[i], sizeof (double));
+    }
+  uint32_t rows = GetNRows ();
+  results::PutU32 (body, rows);
+  results::PutU32 (body, m_columns.size ());
+  for (size_t i = 0; i < m_columns.size (); ++i)
+    {
+      results::PutName (body, m_columnNames[i]);
+      if (rows > 0)
+        {
+          results::Put (body, &m_columns[i][0], rows * sizeof (double));
+        }
+    }
+
+  std::string group;
+  results::PutU32 (group, results::g_groupMagic);
+  results::PutU32 (group, body.size ());
+  group.append (body);
+  return group;
+}
+
+inline uint32_t
+ResultsRowGroup::Deserialize (const char *data, uint32_t size)
+{
+  results::Reader header (data, size);
+  uint32_t magic = header.GetU32 ();
+  uint32_t length = header.GetU32 ();
+  if (!header.IsOk () || magic != results::g_groupMagic || size - header.GetPos () < length)
+    {
+      return 0;
+    }
+
+  results::Reader in (data + header.GetPos (), length);
+  m_metaNames.clear ();
+  m_metaValues.clear ();
+  m_columnNames.clear ();
+  m_columns.clear ();
+
+  uint32_t nMeta = in.GetU32 ();
+  for (uint32_t i = 0; i < nMeta && in.IsOk (); ++i)
+    {
+      std::string name = in.GetName ();
+      double value = 0;
+      in.Get (&value, sizeof (value));
+      m_metaNames.push_back (name);
+      m_metaValues.push_back (value);
+    }
+  uint32_t rows = in.GetU32 ();
+  uint32_t nColumns = in.GetU32 ();
+  // The column names and data must be there before the columns are
+  // allocated, so that a corrupt count is rejected rather than allocated.
+  // Every column takes at least its name's length; checked by division,
+  // as the product of two counts can wrap.
+  uint32_t remaining = in.GetRemaining ();
+  if (!in.IsOk () || nColumns > remaining / sizeof (uint16_t)
+      || (nColumns != 0 && rows > (remaining - nColumns * sizeof (uint16_t)) / sizeof (double) / nColumns))
+    {
+      return 0;
+    }
+  for (uint32_t i = 0; i < nColumns && in.IsOk (); ++i)
+    {
+      m_columnNames.push_back (in.GetName ());
+      m_columns.push_back (std::vector<double> (rows));
+      if (rows > 0)
+        {
+          in.Get (&m_columns.back ()[0], rows * sizeof (double));
+        }
+    }
+  return in.IsOk () ? header.GetPos () + length : 0;
+}
+
+inline void
+ResultsFile::Append (const std::string &path, const std::string &rowGroup)
+{
+  FILE *file = std::fopen (path.c_str (), "ab");
+  if (file == 0)
+    {
+      NS_FATAL_ERROR ("ResultsFile: cannot open " << path << " for appending");
+    }
+  std::fseek (file, 0, SEEK_END);
+  if (std::ftell (file) == 0)
+    {
+      std::fwrite (results::g_fileMagic, 1, sizeof (results::g_fileMagic), file);
+    }
+  if (std::fwrite (rowGroup.data (), 1, rowGroup.size (), file) != rowGroup.size ())
+    {
+      NS_FATAL_ERROR ("ResultsFile: short write to " << path);
+    }
+  std::fclose (file);
+}
+
+inline std::vector<ResultsRowGroup>
+ResultsFile::Load (const std::string &path)
+{
+  std::vector<ResultsRowGroup> groups;
+  FILE *file = std::fopen (path.c_str (), "rb");
+  if (file == 0)
+    {
+      NS_FATAL_ERROR ("ResultsFile: cannot open " << path);
+    }
+  std::fseek (file, 0, SEEK_END);
+  long size = std::ftell (file);
+  std::fseek (file, 0, SEEK_SET);
+  std::string data (size > 0 ? size : 0, '\0');
+  if (size > 0 && std::fread (&data[0], 1, size, file) != (size_t) size)
+    {
+      NS_FATAL_ERROR ("ResultsFile: short read from " << path);
+    }
+  std::fclose (file);
+
+  if (data.size () < sizeof (results::g_fileMagic)
+      || std::memcmp (data.data (), results::g_fileMagic, sizeof (results::g_fileMagic)) != 0)
+    {
+      NS_FATAL_ERROR ("ResultsFile: " << path << " is not a results file");
+    }
+  size_t pos = sizeof (results::g_fileMagic);
+  while (pos < data.size ())
+    {
+      ResultsRowGroup group;
+      uint32_t used = group.Deserialize (data.data () + pos, data.size () - pos);
+      if (used == 0)
+        {
+          // A truncated tail is what an interrupted append leaves behind.
+          std::cerr << "ResultsFile: ignoring malformed data at offset " << pos << " of " << path << std::endl;
+          break;
+        }
+      groups.push_back (group);
+      pos += used;
+    }
+  return groups;
+}
+
+} // namespace ns3
+
+#endif /* RESULTS_STORE_H */
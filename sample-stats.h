@@ -0,0 +1,174 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SAMPLE_STATS_H
+#define SAMPLE_STATS_H
+
+#include <stdint.h>
+#include <cmath>
+
+namespace ns3 {
+
+/**
+ * \brief Two-sided 95% quantile of Student's t distribution.
+ * \param dof degrees of freedom (at least 1)
+ * \return t such that P(|T| < t) = 0.95
+ */
+inline double
+StudentT95 (uint32_t dof)
+{
+  static const double table[30] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+  };
+  if (dof == 0)
+    {
+      return INFINITY;
+    }
+  if (dof <= 30)
+    {
+      return table[dof - 1];
+    }
+  if (dof <= 40)
+    {
+      return 2.021;
+    }
+  if (dof <= 60)
+    {
+      return 2.000;
+    }
+  if (dof <= 120)
+    {
+      return 1.980;
+    }
+  return 1.960;
+}
+
+/**
+ * \brief Running mean and variance of a sample (Welford's algorithm).
+ *
+ * Samples are folded in one at a time; nothing but the count, the mean and
+ * the sum of squared deviations is stored.
+ */
+class SampleStats
+{
+public:
+  SampleStats ();
+
+  /// Add one observation.
+  void Add (double x);
+  /// Fold in every observation of another sample (Chan et al.).
+  void Merge (const SampleStats &other);
+  /// Forget every observation.
+  void Reset (void);
+
+  /// \return the number of observations
+  uint64_t GetCount (void) const;
+  /// \return the sample mean, 0 if there are no observations
+  double GetMean (void) const;
+  /// \return the unbiased sample variance, 0 below two observations
+  double GetVariance (void) const;
+  /// \return the sample standard deviation
+  double GetStddev (void) const;
+  /**
+   * \return the half width of the 95% confidence interval of the mean,
+   *         assuming independent observations; infinite below two.
+   */
+  double GetConfidenceHalfWidth (void) const;
+
+private:
+  uint64_t m_count;
+  double m_mean;
+  double m_m2;
+};
+
+inline
+SampleStats::SampleStats ()
+  : m_count (0),
+    m_mean (0),
+    m_m2 (0)
+{
+}
+
+inline void
+SampleStats::Add (double x)
+{
+  m_count++;
+  double delta = x - m_mean;
+  m_mean += delta / m_count;
+  m_m2 += delta * (x - m_mean);
+}
+
+inline void
+SampleStats::Merge (const SampleStats &other)
+{
+  if (other.m_count == 0)
+    {
+      return;
+    }
+  uint64_t count = m_count + other.m_count;
+  double delta = other.m_mean - m_mean;
+  m_mean += delta * other.m_count / count;
+  m_m2 += other.m_m2 + delta * delta * ((double) m_count * other.m_count / count);
+  m_count = count;
+}
+
+inline void
+SampleStats::Reset (void)
+{
+  m_count = 0;
+  m_mean = 0;
+  m_m2 = 0;
+}
+
+inline uint64_t
+SampleStats::GetCount (void) const
+{
+  return m_count;
+}
+
+inline double
+SampleStats::GetMean (void) const
+{
+  return m_mean;
+}
+
+inline double
+SampleStats::GetVariance (void) const
+{
+  return m_count > 1 ? m_m2 / (m_count - 1) : 0;
+}
+
+inline double
+SampleStats::GetStddev (void) const
+{
+  return std::sqrt (GetVariance ());
+}
+
+inline double
+SampleStats::GetConfidenceHalfWidth (void) const
+{
+  if (m_count < 2)
+    {
+      return INFINITY;
+    }
+  return StudentT95 (m_count - 1) * GetStddev () / std::sqrt ((double) m_count);
+}
+
+} // namespace ns3
+
+#endif /* SAMPLE_STATS_H */
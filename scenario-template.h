@@ -0,0 +1,243 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SCENARIO_TEMPLATE_H
+#define SCENARIO_TEMPLATE_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/wifi-module.h"
+#include "sweep-runner.h"
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+#include <string>
+
+namespace ns3 {
+
+/**
+ * \brief The parts of a built BSS that the per-point code needs: the nodes
+ * to install applications on, the devices to trace and the addresses.
+ */
+struct BssTopology
+{
+  NodeContainer ap;                    //!< the access point(s)
+  NodeContainer sta;                   //!< the stations
+  NetDeviceContainer apDevices;        //!< wifi devices of the access points
+  NetDeviceContainer staDevices;       //!< wifi devices of the stations
+  Ipv4InterfaceContainer apInterfaces; //!< addresses of the access points
+  Ipv4InterfaceContainer staInterfaces; //!< addresses of the stations
+  YansWifiPhyHelper phy;               //!< helper to enable pcap with
+};
+
+/**
+ * \brief Builds a scenario once and runs every load point on top of it.
+ *
+ * The builder (nodes, channel, MACs, mobility, Internet stack, addresses:
+ * everything that does not depend on the offered load) runs once per
+ * replication, before the replication's points are forked.  Each point
+ * then starts from a copy-on-write snapshot of the configured simulation
+ * and only installs its applications and counters; nothing has to be reset
+ * between points since no point ever sees the state of another.
+ *
+ * Random variables draw their run number when they are created, so the
+ * template is rebuilt once per replication, after RngSeedManager::SetRun.
+ * Jobs can query the replication with RngSeedManager::GetRun ().
+ *
+ * Each replication is itself a forked job that builds its template and
+ * forks its points from it, and the runner's workers are shared among the
+ * replications running at once, so that every (point, replication) job
+ * keeps a core busy whether there are many points or many replications.
+ *
+ * With a warm-up time set, the parent also simulates the common prefix of
+ * every point (association, beacons, ...) up to that time and the workers
+ * fork from there, so each point skips the warm-up and all of them start
+ * from the same MAC state.  Jobs then run with a clock already past zero:
+ * Simulator::Schedule, Simulator::Stop and Application::Start all take
+ * delays relative to now, which Until () converts from absolute times.
+ */
+class ScenarioTemplate
+{
+public:
+  /// Builds the load-independent part of the scenario into the topology.
+  typedef Callback<void, BssTopology &> Builder;
+
+  ScenarioTemplate ();
+
+  /// \param builder the scenario builder
+  void SetBuilder (Builder builder);
+
+  /**
+   * \param warmup simulated time the parent runs before forking the jobs;
+   *        zero (the default) forks right after the build.
+   */
+  void SetWarmup (Time warmup);
+  /// \return the warm-up time
+  Time GetWarmup (void) const;
+
+  /**
+   * \param at an absolute simulation time
+   * \return the delay from now until then, to schedule at an absolute time
+   *         whether or not the job was forked after a warm-up
+   */
+  static Time Until (Time at);
+
+  /**
+   * \return the topology built for the current replication; only valid
+   *         inside a job.
+   */
+  const BssTopology & GetTopology (void) const;
+
+  /**
+   * Run nPoints jobs for each of nRuns replications.
+   *
+   * \param runner the runner executing the jobs
+   * \param firstRun the RngRun of the first replication
+   * \param nRuns the number of replications
+   * \param nPoints the number of jobs per replication
+   * \param job the job body; receives the point index
+   * \return the results, replication r of point p at p * nRuns + r
+   */
+  std::vector<std::string> Run (SweepRunner &runner, uint32_t firstRun, uint32_t nRuns,
+                                uint32_t nPoints, SweepRunner::Job job);
+
+private:
+  /// Build, warm up and run the points of replication r; in its own process.
+  std::string RunReplication (uint32_t r);
+
+  Builder m_builder;
+  BssTopology m_topology;
+  Time m_warmup;
+  // The current Run (), for RunReplication ().
+  SweepRunner::Job m_job;
+  uint32_t m_firstRun;
+  uint32_t m_nPoints;
+  uint32_t m_cores;
+  uint32_t m_concurrent;
+};
+
+inline
+ScenarioTemplate::ScenarioTemplate ()
+  : m_firstRun (1),
+    m_nPoints (0),
+    m_cores (1),
+    m_concurrent (1)
+{
+}
+
+inline void
+ScenarioTemplate::SetBuilder (Builder builder)
+{
+  m_builder = builder;
+}
+
+inline const BssTopology &
+ScenarioTemplate::GetTopology (void) const
+{
+  return m_topology;
+}
+
+inline void
+ScenarioTemplate::SetWarmup (Time warmup)
+{
+  m_warmup = warmup;
+}
+
+inline Time
+ScenarioTemplate::GetWarmup (void) const
+{
+  return m_warmup;
+}
+
+inline Time
+ScenarioTemplate::Until (Time at)
+{
+  NS_ABORT_MSG_IF (at < Simulator::Now (), "ScenarioTemplate: " << at << " is already past");
+  return at - Simulator::Now ();
+}
+
+inline std::vector<std::string>
+ScenarioTemplate::Run (SweepRunner &runner, uint32_t firstRun, uint32_t nRuns,
+                       uint32_t nPoints, SweepRunner::Job job)
+{
+  NS_ABORT_MSG_IF (m_builder.IsNull (), "ScenarioTemplate: no builder set");
+  std::vector<std::string> results (nPoints * nRuns);
+  if (nRuns == 0 || nPoints == 0)
+    {
+      return results;
+    }
+  m_job = job;
+  m_firstRun = firstRun;
+  m_nPoints = nPoints;
+  m_cores = runner.GetMaxJobs ();
+  m_concurrent = std::min (nRuns, m_cores);
+
+  SweepRunner replications;
+  replications.SetMaxJobs (m_concurrent);
+  std::vector<std::string> packed = replications.Run (nRuns, MakeCallback (&ScenarioTemplate::RunReplication, this));
+  for (uint32_t r = 0; r < nRuns; ++r)
+    {
+      // The points' results, each behind its 32-bit length.
+      const std::string &in = packed[r];
+      size_t pos = 0;
+      for (uint32_t p = 0; p < nPoints; ++p)
+        {
+          uint32_t length = 0;
+          NS_ABORT_MSG_IF (in.size () - pos < sizeof (length), "ScenarioTemplate: truncated results of replication " << r);
+          in.copy (reinterpret_cast<char *> (&length), sizeof (length), pos);
+          pos += sizeof (length);
+          NS_ABORT_MSG_IF (in.size () - pos < length, "ScenarioTemplate: truncated results of replication " << r);
+          results[p * nRuns + r] = in.substr (pos, length);
+          pos += length;
+        }
+    }
+  return results;
+}
+
+inline std::string
+ScenarioTemplate::RunReplication (uint32_t r)
+{
+  RngSeedManager::SetRun (m_firstRun + r);
+  m_topology = BssTopology ();
+  m_builder (m_topology);
+  if (m_warmup.IsStrictlyPositive ())
+    {
+      Simulator::Stop (m_warmup);
+      Simulator::Run ();
+    }
+
+  // Share the cores among the replications that run at the same time.
+  uint32_t slot = r % m_concurrent;
+  SweepRunner points;
+  points.SetMaxJobs (m_cores / m_concurrent + (slot < m_cores % m_concurrent ? 1 : 0));
+  std::vector<std::string> results = points.Run (m_nPoints, m_job);
+
+  std::string packed;
+  for (uint32_t p = 0; p < m_nPoints; ++p)
+    {
+      uint32_t length = results[p].size ();
+      packed.append (reinterpret_cast<const char *> (&length), sizeof (length));
+      packed.append (results[p]);
+    }
+  m_topology = BssTopology ();
+  Simulator::Destroy ();
+  return packed;
+}
+
+} // namespace ns3
+
+#endif /* SCENARIO_TEMPLATE_H */
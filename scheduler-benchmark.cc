@@ -0,0 +1,131 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * Compares the event schedulers (see ladder-scheduler.h) on the dense BSS
+ * scenarios: every scenario runs with every scheduler, the best wall-clock
+ * time of --repeats runs is reported with its speed-up over the first
+ * scheduler, and the scenario output is checked to be the same with every
+ * scheduler, as it must be: the schedulers order events identically.
+ *
+ *   ./waf build
+ *   ./waf --run scheduler-benchmark
+ *   ./waf --run "scheduler-benchmark --schedulers=map,ladder --repeats=5"
+ */
+
+#include "ns3/core-module.h"
+#include <algorithm>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+using namespace ns3;
+
+static std::vector<std::string>
+Split (std::string list)
+{
+  std::vector<std::string> items;
+  std::istringstream in (list);
+  std::string item;
+  while (std::getline (in, item, ','))
+    {
+      items.push_back (item);
+    }
+  return items;
+}
+
+/* Run a command, returning its exit status, its output and its wall-clock time. */
+static int
+Execute (std::string command, std::string &output, double &seconds)
+{
+  struct timeval start, end;
+  gettimeofday (&start, 0);
+  FILE *pipe = popen (command.c_str (), "r");
+  NS_ABORT_MSG_IF (pipe == 0, "Cannot run " << command);
+  output.clear ();
+  char buffer[4096];
+  size_t n;
+  while ((n = fread (buffer, 1, sizeof (buffer), pipe)) > 0)
+    {
+      output.append (buffer, n);
+    }
+  int status = pclose (pipe);
+  gettimeofday (&end, 0);
+  seconds = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1e6;
+  return WIFEXITED (status) ? WEXITSTATUS (status) : -1;
+}
+
+int
+main (int argc, char *argv[])
+{
+  std::string scenarios = "80211b,wifi-singleap";
+  std::string schedulers = "map,heap,calendar,ladder";
+  std::string binDir = "build/scratch";
+  std::string args = "--pcap=0";
+  uint32_t repeats = 3;
+
+  CommandLine cmd;
+  cmd.AddValue ("scenarios", "Comma-separated scenarios to run", scenarios);
+  cmd.AddValue ("schedulers", "Comma-separated schedulers to compare, the first being the reference", schedulers);
+  cmd.AddValue ("binDir", "Directory of the built scenario programs", binDir);
+  cmd.AddValue ("args", "Arguments passed to 80211b (wifi-singleap has no pcap switch)", args);
+  cmd.AddValue ("repeats", "Runs per scenario and scheduler; the fastest counts", repeats);
+  cmd.Parse (argc, argv);
+
+  std::vector<std::string> scenarioList = Split (scenarios);
+  std::vector<std::string> schedulerList = Split (schedulers);
+  bool failed = false;
+
+  std::cout << std::left << std::setw (16) << "scenario" << std::setw (12) << "scheduler"
+            << std::setw (12) << "wall (s)" << std::setw (10) << "speed-up" << "output" << std::endl;
+  for (uint32_t i = 0; i < scenarioList.size (); ++i)
+    {
+      std::string reference;
+      double referenceSeconds = 0;
+      for (uint32_t j = 0; j < schedulerList.size (); ++j)
+        {
+          std::string command = binDir + "/" + scenarioList[i] + " --scheduler=" + schedulerList[j];
+          if (scenarioList[i] == "80211b")
+            {
+              command += " " + args;
+            }
+          std::string output;
+          double best = 0;
+          int status = 0;
+          for (uint32_t r = 0; r < repeats; ++r)
+            {
+              double seconds;
+              status |= Execute (command, output, seconds);
+              best = (r == 0) ? seconds : std::min (best, seconds);
+            }
+          if (j == 0)
+            {
+              reference = output;
+              referenceSeconds = best;
+            }
+          std::string check = (status != 0) ? "FAILED" : (output == reference ? "same" : "DIFFERENT");
+          failed |= (check != "same");
+          std::cout << std::setw (16) << scenarioList[i] << std::setw (12) << schedulerList[j]
+                    << std::setw (12) << best << std::setw (10) << referenceSeconds / best << check << std::endl;
+        }
+    }
+  return failed;
+}
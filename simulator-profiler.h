@@ -0,0 +1,308 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SIMULATOR_PROFILER_H
+#define SIMULATOR_PROFILER_H
+
+#include "ns3/core-module.h"
+#include "benchmark-report.h"
+#include <stdint.h>
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <cxxabi.h>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <typeinfo>
+#include <vector>
+#include <unistd.h>
+
+namespace ns3 {
+
+/**
+ * \brief A CountingScheduler that profiles the simulation it schedules.
+ *
+ * It records the events executed, the peak number of pending events and,
+ * per kind of event, how many ran and the wall time they took.  An event's
+ * time is measured from the moment the simulator removes it from the queue
+ * to the moment it next looks at the queue (IsEmpty () or PeekNext (),
+ * which Simulator::Run calls after every event), i.e. the callback plus
+ * the scheduling it does; whatever the script does after Run () is not
+ * charged to the last event.
+ *
+ * Events are grouped by the C++ type of their callback, which for the
+ * usual Simulator::Schedule (&Class::Method, object, ...) names the class
+ * and the method's signature: YansWifiPhy::EndReceive, the MacLow and
+ * DcfManager timers, TcpSocketBase timers, OnOffApplication::SendPacket
+ * and so on each get their own line.
+ *
+ * The summary is printed to std::cout from a Simulator::ScheduleDestroy ()
+ * hook, i.e. at Simulator::Destroy () but before the simulator discards the
+ * events still pending, which are not counted.  Select it with
+ * --SchedulerType=ns3::ProfilingScheduler or Enable ().
+ */
+class ProfilingScheduler : public CountingScheduler
+{
+public:
+  static TypeId GetTypeId (void);
+
+  ProfilingScheduler ();
+  virtual ~ProfilingScheduler ();
+
+  /// Use the ProfilingScheduler for every simulation of this process.
+  static void Enable (void);
+
+  virtual void Insert (const Scheduler::Event &ev);
+  virtual bool IsEmpty (void) const;
+  virtual Scheduler::Event PeekNext (void) const;
+  virtual Scheduler::Event RemoveNext (void);
+  virtual void Remove (const Scheduler::Event &ev);
+
+  /// Print the summary, most expensive kind of event first.
+  void Print (std::ostream &os) const;
+
+private:
+  struct Kind
+  {
+    uint64_t count;
+    int64_t ns;
+  };
+
+  static int64_t Now (void);
+  static std::string GetName (const std::type_info *type);
+
+  /// Charge the event being executed, if any, with the time until now.
+  void Close (void) const;
+  /// The destroy hook: print the summary and stop profiling.
+  void Finish (void);
+
+  mutable std::map<const std::type_info *, Kind> m_kinds;
+  mutable const std::type_info *m_current;   //!< kind of the event being executed
+  int64_t m_currentStart;            //!< when it was handed out, in ns
+  int64_t m_firstStart;
+  mutable int64_t m_lastEnd;         //!< when the last event closed, in ns
+  bool m_finished;                   //!< printed; the rest is the queue being discarded
+  uint64_t m_events;
+  uint32_t m_size;
+  uint32_t m_peakSize;
+};
+
+NS_OBJECT_ENSURE_REGISTERED (ProfilingScheduler);
+
+inline TypeId
+ProfilingScheduler::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::ProfilingScheduler")
+    .SetParent<CountingScheduler> ()
+    .SetGroupName ("Core")
+    .AddConstructor<ProfilingScheduler> ()
+  ;
+  return tid;
+}
+
+inline
+ProfilingScheduler::ProfilingScheduler ()
+  : m_current (0),
+    m_currentStart (0),
+    m_firstStart (0),
+    m_lastEnd (0),
+    m_finished (false),
+    m_events (0),
+    m_size (0),
+    m_peakSize (0)
+{
+}
+
+inline
+ProfilingScheduler::~ProfilingScheduler ()
+{
+}
+
+inline void
+ProfilingScheduler::Finish (void)
+{
+  Close ();
+  m_finished = true;
+  std::ostringstream os;
+  Print (os);
+  std::cout << os.str () << std::flush;
+}
+
+inline void
+ProfilingScheduler::Enable (void)
+{
+  // The global value covers the simulations after the next Destroy ();
+  // the current one switches now.
+  GlobalValue::Bind ("SchedulerType", StringValue ("ns3::ProfilingScheduler"));
+  ObjectFactory factory;
+  factory.SetTypeId ("ns3::ProfilingScheduler");
+  Simulator::SetScheduler (factory);
+}
+
+inline int64_t
+ProfilingScheduler::Now (void)
+{
+  struct timespec now;
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+inline void
+ProfilingScheduler::Insert (const Scheduler::Event &ev)
+{
+  CountingScheduler::Insert (ev);
+  m_size++;
+  m_peakSize = std::max (m_peakSize, m_size);
+}
+
+inline void
+ProfilingScheduler::Remove (const Scheduler::Event &ev)
+{
+  CountingScheduler::Remove (ev);
+  m_size--;
+}
+
+inline void
+ProfilingScheduler::Close (void) const
+{
+  if (m_current != 0)
+    {
+      m_lastEnd = Now ();
+      Kind &kind = m_kinds[m_current];
+      kind.count++;
+      kind.ns += m_lastEnd - m_currentStart;
+      m_current = 0;
+    }
+}
+
+inline bool
+ProfilingScheduler::IsEmpty (void) const
+{
+  Close ();
+  return CountingScheduler::IsEmpty ();
+}
+
+inline Scheduler::Event
+ProfilingScheduler::PeekNext (void) const
+{
+  Close ();
+  return CountingScheduler::PeekNext ();
+}
+
+inline Scheduler::Event
+ProfilingScheduler::RemoveNext (void)
+{
+  if (m_finished)
+    {
+      m_size--;
+      return CountingScheduler::RemoveNext ();
+    }
+  Close ();
+  int64_t now = Now ();
+  Scheduler::Event ev = CountingScheduler::RemoveNext ();
+  m_size--;
+  if (m_events == 0)
+    {
+      m_firstStart = now;
+      // The Ptr keeps this scheduler alive until the hook has run, should
+      // another one replace it in the meantime.
+      Simulator::ScheduleDestroy (&ProfilingScheduler::Finish, Ptr<ProfilingScheduler> (this));
+    }
+  m_events++;
+  m_current = &typeid (*ev.impl);
+  m_currentStart = now;
+  return ev;
+}
+
+inline std::string
+ProfilingScheduler::GetName (const std::type_info *type)
+{
+  int status = 0;
+  char *demangled = abi::__cxa_demangle (type->name (), 0, 0, &status);
+  std::string name = (status == 0) ? demangled : type->name ();
+  std::free (demangled);
+
+  // Keep the callback's own type: the member function pointer (or the
+  // function pointer) that MakeEvent was instantiated with.
+  std::string::size_type begin = name.find ('<');
+  if (begin != std::string::npos)
+    {
+      uint32_t depth = 0;
+      std::string::size_type end;
+      for (end = begin + 1; end < name.size (); ++end)
+        {
+          if (name[end] == '<' || name[end] == '(')
+            {
+              depth++;
+            }
+          else if (name[end] == '>' || name[end] == ')')
+            {
+              if (depth == 0)
+                {
+                  break;
+                }
+              depth--;
+            }
+          else if (name[end] == ',' && depth == 0)
+            {
+              break;
+            }
+        }
+      name = name.substr (begin + 1, end - begin - 1);
+    }
+  std::string::size_type ns;
+  while ((ns = name.find ("ns3::")) != std::string::npos)
+    {
+      name.erase (ns, 5);
+    }
+  return name;
+}
+
+inline void
+ProfilingScheduler::Print (std::ostream &os) const
+{
+  std::vector<std::pair<int64_t, const std::type_info *> > order;
+  int64_t total = 0;
+  for (std::map<const std::type_info *, Kind>::const_iterator i = m_kinds.begin (); i != m_kinds.end (); ++i)
+    {
+      order.push_back (std::make_pair (i->second.ns, i->first));
+      total += i->second.ns;
+    }
+  std::sort (order.rbegin (), order.rend ());
+
+  double seconds = (m_lastEnd - m_firstStart) / 1e9;
+  os << "Simulator profile (pid " << getpid () << "): " << m_events << " events in " << seconds << " s, "
+     << (seconds > 0 ? m_events / seconds : 0) << " events/s, peak queue " << m_peakSize << " events" << std::endl;
+  os << std::setw (12) << "events" << std::setw (12) << "total ms" << std::setw (10) << "mean us"
+     << std::setw (8) << "share" << "  callback" << std::endl;
+  for (uint32_t i = 0; i < order.size (); ++i)
+    {
+      const Kind &kind = m_kinds.find (order[i].second)->second;
+      os << std::setw (12) << kind.count
+         << std::setw (12) << std::fixed << std::setprecision (1) << kind.ns / 1e6
+         << std::setw (10) << std::setprecision (2) << kind.ns / 1e3 / kind.count
+         << std::setw (7) << std::setprecision (1) << (total > 0 ? 100.0 * kind.ns / total : 0) << "%"
+         << "  " << GetName (order[i].second) << std::endl;
+    }
+  os.unsetf (std::ios::fixed);
+}
+
+} // namespace ns3
+
+#endif /* SIMULATOR_PROFILER_H */
@@ -0,0 +1,244 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef STEADY_STATE_DETECTOR_H
+#define STEADY_STATE_DETECTOR_H
+
+#include "ns3/core-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/flow-monitor-module.h"
+#include "flow-stats-collector.h"
+#include "sample-stats.h"
+#include <stdint.h>
+#include <cmath>
+#include <map>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief Stops the simulation once throughput and delay have converged.
+ *
+ * Every batch interval the detector reads the bytes received by the sinks
+ * and the delays summed by a FlowStatsCollector or a FlowMonitor, and takes
+ * the throughput and the mean delay of the batch as one observation each:
+ * the method of batch means.  The first batch, which holds the start-up of
+ * the sources, is dropped.  From the minimum time on, once there are at
+ * least MIN_BATCHES batches and the 95% confidence intervals of both means
+ * are narrower than the target fraction of the mean, it calls
+ * Simulator::Stop ().  The script's own Simulator::Stop () is the maximum
+ * time.
+ *
+ * A batch must be long compared to the correlation time of the metrics
+ * (queueing, TCP's congestion window) for its mean to be independent of the
+ * next one's; the default of 100 ms is about 100 frames at 11 Mbit/s.
+ * After the run, GetElapsed () is the time the rates must be divided by.
+ */
+class SteadyStateDetector
+{
+public:
+  SteadyStateDetector ();
+
+  /// Count the bytes received by these sinks.
+  void Add (ApplicationContainer sinks);
+  /// Read the delays from a collector; it must outlive the run.
+  void SetFlowStats (const FlowStatsCollector *flowStats);
+  /// Read the delays from a FlowMonitor instead.
+  void SetFlowMonitor (Ptr<FlowMonitor> monitor);
+
+  /**
+   * \param batch the batch length
+   * \param minTime the time to run at least, counted from Start ()
+   * \param target the half width of the confidence intervals, relative to the mean
+   */
+  void Configure (Time batch, Time minTime, double target);
+
+  /// Start measuring after delay, when the sources start.
+  void Start (Time delay);
+
+  /// \return whether the run was stopped by the detector
+  bool HasConverged (void) const;
+  /// \return the simulated time measured, from Start () to the stop
+  Time GetElapsed (void) const;
+  /// \return the batch means of throughput (bit/s) and delay (s)
+  const SampleStats & GetThroughput (void) const;
+  const SampleStats & GetDelay (void) const;
+
+private:
+  /// Fewer batch means give a meaningless variance estimate.
+  static const uint32_t MIN_BATCHES = 10;
+
+  void ReadCounters (uint64_t &rxBytes, uint64_t &rxPackets, double &delaySum) const;
+  void EndBatch (void);
+
+  std::vector<Ptr<PacketSink> > m_sinks;
+  const FlowStatsCollector *m_flowStats;
+  Ptr<FlowMonitor> m_monitor;
+  Time m_batch;
+  Time m_minTime;
+  double m_target;
+  Time m_start;
+  uint32_t m_batches;
+  bool m_converged;
+  uint64_t m_lastRxBytes;
+  uint64_t m_lastRxPackets;
+  double m_lastDelaySum;
+  SampleStats m_throughput;
+  SampleStats m_delay;
+};
+
+inline
+SteadyStateDetector::SteadyStateDetector ()
+  : m_flowStats (0),
+    m_batch (MilliSeconds (100)),
+    m_minTime (Seconds (1)),
+    m_target (0.05),
+    m_batches (0),
+    m_converged (false),
+    m_lastRxBytes (0),
+    m_lastRxPackets (0),
+    m_lastDelaySum (0)
+{
+}
+
+inline void
+SteadyStateDetector::Add (ApplicationContainer sinks)
+{
+  for (ApplicationContainer::Iterator i = sinks.Begin (); i != sinks.End (); ++i)
+    {
+      Ptr<PacketSink> sink = DynamicCast<PacketSink> (*i);
+      NS_ABORT_MSG_IF (sink == 0, "SteadyStateDetector: not a PacketSink");
+      m_sinks.push_back (sink);
+    }
+}
+
+inline void
+SteadyStateDetector::SetFlowStats (const FlowStatsCollector *flowStats)
+{
+  m_flowStats = flowStats;
+}
+
+inline void
+SteadyStateDetector::SetFlowMonitor (Ptr<FlowMonitor> monitor)
+{
+  m_monitor = monitor;
+}
+
+inline void
+SteadyStateDetector::Configure (Time batch, Time minTime, double target)
+{
+  NS_ABORT_MSG_IF (!batch.IsStrictlyPositive () || target <= 0, "SteadyStateDetector: bad configuration");
+  m_batch = batch;
+  m_minTime = minTime;
+  m_target = target;
+}
+
+inline void
+SteadyStateDetector::Start (Time delay)
+{
+  m_start = Simulator::Now () + delay;
+  Simulator::Schedule (delay + m_batch, &SteadyStateDetector::EndBatch, this);
+}
+
+inline void
+SteadyStateDetector::ReadCounters (uint64_t &rxBytes, uint64_t &rxPackets, double &delaySum) const
+{
+  rxBytes = 0;
+  for (uint32_t i = 0; i < m_sinks.size (); ++i)
+    {
+      rxBytes += m_sinks[i]->GetTotalRx ();
+    }
+  rxPackets = 0;
+  delaySum = 0;
+  if (m_flowStats != 0)
+    {
+      for (FlowId id = 1; id <= m_flowStats->GetNFlows (); ++id)
+        {
+          const FlowStatsCollector::FlowRecord &flow = m_flowStats->GetFlow (id);
+          rxPackets += flow.delay.GetCount ();
+          delaySum += flow.delay.GetMean () * flow.delay.GetCount ();
+        }
+    }
+  else if (m_monitor != 0)
+    {
+      const FlowMonitor::FlowStatsContainer &stats = m_monitor->GetFlowStats ();
+      for (FlowMonitor::FlowStatsContainerCI i = stats.begin (); i != stats.end (); ++i)
+        {
+          rxPackets += i->second.rxPackets;
+          delaySum += i->second.delaySum.GetSeconds ();
+        }
+    }
+}
+
+inline void
+SteadyStateDetector::EndBatch (void)
+{
+  uint64_t rxBytes, rxPackets;
+  double delaySum;
+  ReadCounters (rxBytes, rxPackets, delaySum);
+  if (m_batches++ > 0)
+    {
+      m_throughput.Add ((rxBytes - m_lastRxBytes) * 8.0 / m_batch.GetSeconds ());
+      if (rxPackets > m_lastRxPackets)
+        {
+          m_delay.Add ((delaySum - m_lastDelaySum) / (rxPackets - m_lastRxPackets));
+        }
+    }
+  m_lastRxBytes = rxBytes;
+  m_lastRxPackets = rxPackets;
+  m_lastDelaySum = delaySum;
+
+  bool hasDelay = m_flowStats != 0 || m_monitor != 0;
+  if (Simulator::Now () - m_start >= m_minTime
+      && m_throughput.GetCount () >= MIN_BATCHES
+      && m_throughput.GetConfidenceHalfWidth () <= m_target * std::fabs (m_throughput.GetMean ())
+      && (!hasDelay || (m_delay.GetCount () >= MIN_BATCHES
+                        && m_delay.GetConfidenceHalfWidth () <= m_target * m_delay.GetMean ())))
+    {
+      m_converged = true;
+      Simulator::Stop ();
+      return;
+    }
+  Simulator::Schedule (m_batch, &SteadyStateDetector::EndBatch, this);
+}
+
+inline bool
+SteadyStateDetector::HasConverged (void) const
+{
+  return m_converged;
+}
+
+inline Time
+SteadyStateDetector::GetElapsed (void) const
+{
+  return Simulator::Now () - m_start;
+}
+
+inline const SampleStats &
+SteadyStateDetector::GetThroughput (void) const
+{
+  return m_throughput;
+}
+
+inline const SampleStats &
+SteadyStateDetector::GetDelay (void) const
+{
+  return m_delay;
+}
+
+} // namespace ns3
+
+#endif /* STEADY_STATE_DETECTOR_H */
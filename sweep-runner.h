@@ -0,0 +1,244 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SWEEP_RUNNER_H
+#define SWEEP_RUNNER_H
+
+#include "ns3/core-module.h"
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+namespace ns3 {
+
+/**
+ * \brief Runs independent simulation jobs in forked worker processes.
+ *
+ * Every job runs in a child process of its own, so it gets a private copy of
+ * the Simulator, the NodeList and the Config defaults and can call
+ * Simulator::Destroy () without disturbing the other jobs.  Anything the
+ * parent built before calling Run () is inherited copy-on-write by each job.
+ *
+ * A job reports its result as a string which is passed back over a pipe; Run
+ * returns the results in job order, whatever order the workers finish in.
+ */
+class SweepRunner
+{
+public:
+  /// A job receives its index in [0, nJobs) and returns its result.
+  typedef Callback<std::string, uint32_t> Job;
+
+  SweepRunner ();
+
+  /**
+   * \param maxJobs the maximum number of concurrent workers; 0 means one
+   *        worker per online CPU.
+   */
+  void SetMaxJobs (uint32_t maxJobs);
+
+  /// \return the number of workers Run () will keep busy.
+  uint32_t GetMaxJobs (void) const;
+
+  /**
+   * Run jobs 0 .. nJobs-1 and collect their results.
+   *
+   * \param nJobs the number of jobs
+   * \param job the job body, executed in the worker process
+   * \return the job results, indexed by job
+   */
+  std::vector<std::string> Run (uint32_t nJobs, Job job);
+
+private:
+  struct Worker
+  {
+    pid_t pid;
+    int fd;
+    uint32_t index;
+  };
+
+  Worker Spawn (uint32_t index, Job job);
+  void Reap (const Worker &worker);
+
+  uint32_t m_maxJobs;
+};
+
+inline
+SweepRunner::SweepRunner ()
+  : m_maxJobs (0)
+{
+}
+
+inline void
+SweepRunner::SetMaxJobs (uint32_t maxJobs)
+{
+  m_maxJobs = maxJobs;
+}
+
+inline uint32_t
+SweepRunner::GetMaxJobs (void) const
+{
+  if (m_maxJobs != 0)
+    {
+      return m_maxJobs;
+    }
+  long cpus = sysconf (_SC_NPROCESSORS_ONLN);
+  return cpus > 0 ? static_cast<uint32_t> (cpus) : 1;
+}
+
+inline SweepRunner::Worker
+SweepRunner::Spawn (uint32_t index, Job job)
+{
+  int fds[2];
+  if (pipe (fds) != 0)
+    {
+      NS_FATAL_ERROR ("SweepRunner: pipe () failed: " << std::strerror (errno));
+    }
+
+  // Anything still buffered would otherwise be printed once by every child.
+  std::cout.flush ();
+  std::cerr.flush ();
+  std::fflush (0);
+
+  pid_t pid = fork ();
+  if (pid < 0)
+    {
+      NS_FATAL_ERROR ("SweepRunner: fork () failed: " << std::strerror (errno));
+    }
+  if (pid == 0)
+    {
+      close (fds[0]);
+      std::string result = job (index);
+      const char *data = result.data ();
+      size_t left = result.size ();
+      while (left > 0)
+        {
+          ssize_t n = write (fds[1], data, left);
+          if (n < 0 && errno == EINTR)
+            {
+              continue;
+            }
+          if (n <= 0)
+            {
+              _exit (2);
+            }
+          data += n;
+          left -= n;
+        }
+      close (fds[1]);
+      std::cout.flush ();
+      std::cerr.flush ();
+      std::fflush (0);
+      _exit (0);
+    }
+
+  close (fds[1]);
+  Worker worker;
+  worker.pid = pid;
+  worker.fd = fds[0];
+  worker.index = index;
+  return worker;
+}
+
+inline void
+SweepRunner::Reap (const Worker &worker)
+{
+  close (worker.fd);
+  int status = 0;
+  while (waitpid (worker.pid, &status, 0) < 0)
+    {
+      if (errno != EINTR)
+        {
+          NS_FATAL_ERROR ("SweepRunner: waitpid () failed: " << std::strerror (errno));
+        }
+    }
+  if (!WIFEXITED (status) || WEXITSTATUS (status) != 0)
+    {
+      NS_FATAL_ERROR ("SweepRunner: job " << worker.index << " (pid " << worker.pid << ") failed");
+    }
+}
+
+inline std::vector<std::string>
+SweepRunner::Run (uint32_t nJobs, Job job)
+{
+  std::vector<std::string> results (nJobs);
+  std::vector<Worker> active;
+  uint32_t maxJobs = GetMaxJobs ();
+  uint32_t next = 0;
+  char buffer[4096];
+
+  while (next < nJobs || !active.empty ())
+    {
+      while (next < nJobs && active.size () < maxJobs)
+        {
+          active.push_back (Spawn (next++, job));
+        }
+
+      // Drain the pipes as data arrives: a worker with a large result would
+      // otherwise block on a full pipe before it could exit.
+      std::vector<struct pollfd> fds (active.size ());
+      for (size_t i = 0; i < active.size (); ++i)
+        {
+          fds[i].fd = active[i].fd;
+          fds[i].events = POLLIN;
+          fds[i].revents = 0;
+        }
+      if (poll (&fds[0], fds.size (), -1) < 0)
+        {
+          if (errno == EINTR)
+            {
+              continue;
+            }
+          NS_FATAL_ERROR ("SweepRunner: poll () failed: " << std::strerror (errno));
+        }
+
+      std::vector<Worker> running;
+      for (size_t i = 0; i < active.size (); ++i)
+        {
+          if (fds[i].revents == 0)
+            {
+              running.push_back (active[i]);
+              continue;
+            }
+          ssize_t n = read (active[i].fd, buffer, sizeof (buffer));
+          if (n < 0 && errno == EINTR)
+            {
+              running.push_back (active[i]);
+            }
+          else if (n > 0)
+            {
+              results[active[i].index].append (buffer, n);
+              running.push_back (active[i]);
+            }
+          else
+            {
+              Reap (active[i]);
+            }
+        }
+      active.swap (running);
+    }
+  return results;
+}
+
+} // namespace ns3
+
+#endif /* SWEEP_RUNNER_H */
@@ -0,0 +1,162 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef TABLE_ERROR_RATE_MODEL_H
+#define TABLE_ERROR_RATE_MODEL_H
+
+#include "ns3/core-module.h"
+#include "ns3/wifi-module.h"
+#include <stdint.h>
+#include <cmath>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief An error rate model answering from SNR tables precomputed with
+ * another error rate model.
+ *
+ * The YANS and NIST models compute the bit error rate of a chunk with
+ * erfc, square roots and a sum of powers over the code's distance spectrum,
+ * for every chunk of every frame.  All of them then return (1 - p)^nbits
+ * for the per-bit error probability p of the mode at that SNR, so p alone
+ * can be tabulated.  The first time a mode is used, the Inner model is
+ * asked for p at every point of a grid of 64 points per octave of SNR (under
+ * 0.07 dB apart) from -33 to 63 dB, about 2000 calls; afterwards a chunk
+ * costs an frexp, a linear interpolation of log p, and two exp.
+ *
+ * log p is smooth in the SNR, so the interpolated value stays within a
+ * fraction of a percent of the exact one even on the steep part of the
+ * curve.  SNRs outside the grid go to the Inner model.
+ *
+ * The tables are indexed by the mode only: the txVector of the first chunk
+ * of a mode is used to build its table, which is right for the YANS and
+ * NIST models of this release, as they ignore it.
+ */
+class TableErrorRateModel : public ErrorRateModel
+{
+public:
+  static TypeId GetTypeId (void);
+
+  TableErrorRateModel ();
+
+  virtual double GetChunkSuccessRate (WifiMode mode, WifiTxVector txVector, double snr, uint32_t nbits) const;
+
+protected:
+  virtual void NotifyConstructionCompleted (void);
+
+private:
+  /// Grid points per octave of SNR.
+  static const int32_t STEPS = 64;
+  /// The grid covers snr in [2^(MIN_EXP - 1), 2^(MAX_EXP - 1)).
+  static const int32_t MIN_EXP = -10;
+  static const int32_t MAX_EXP = 22;
+
+  const std::vector<double> &GetTable (WifiMode mode, WifiTxVector txVector) const;
+
+  TypeId m_innerType;
+  Ptr<ErrorRateModel> m_inner;
+  /// log p per grid point, by mode uid; empty until the mode is used.
+  mutable std::vector<std::vector<double> > m_tables;
+};
+
+NS_OBJECT_ENSURE_REGISTERED (TableErrorRateModel);
+
+inline TypeId
+TableErrorRateModel::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::TableErrorRateModel")
+    .SetParent<ErrorRateModel> ()
+    .SetGroupName ("Wifi")
+    .AddConstructor<TableErrorRateModel> ()
+    .AddAttribute ("Inner", "The error rate model the tables are computed with.",
+                   TypeIdValue (YansErrorRateModel::GetTypeId ()),
+                   MakeTypeIdAccessor (&TableErrorRateModel::m_innerType),
+                   MakeTypeIdChecker ())
+  ;
+  return tid;
+}
+
+inline
+TableErrorRateModel::TableErrorRateModel ()
+{
+}
+
+inline void
+TableErrorRateModel::NotifyConstructionCompleted (void)
+{
+  ErrorRateModel::NotifyConstructionCompleted ();
+  ObjectFactory factory;
+  factory.SetTypeId (m_innerType);
+  m_inner = factory.Create<ErrorRateModel> ();
+}
+
+inline const std::vector<double> &
+TableErrorRateModel::GetTable (WifiMode mode, WifiTxVector txVector) const
+{
+  uint32_t uid = mode.GetUid ();
+  if (uid >= m_tables.size ())
+    {
+      m_tables.resize (uid + 1);
+    }
+  std::vector<double> &table = m_tables[uid];
+  if (table.empty ())
+    {
+      table.resize ((MAX_EXP - MIN_EXP) * STEPS + 1);
+      for (uint32_t i = 0; i < table.size (); ++i)
+        {
+          // Point i is 2^(e - 1) * (1 + k / STEPS), the inverse of the
+          // frexp indexing of GetChunkSuccessRate.
+          double snr = std::ldexp (1.0 + double (i % STEPS) / STEPS, MIN_EXP + int32_t (i / STEPS) - 1);
+          double success = m_inner->GetChunkSuccessRate (mode, txVector, snr, 1);
+          // log p, kept finite at both ends so that interpolation works.
+          if (success >= 1)
+            {
+              table[i] = -745;
+            }
+          else if (success <= 0)
+            {
+              table[i] = 709;
+            }
+          else
+            {
+              table[i] = std::log (-std::log1p (success - 1));
+            }
+        }
+    }
+  return table;
+}
+
+inline double
+TableErrorRateModel::GetChunkSuccessRate (WifiMode mode, WifiTxVector txVector, double snr, uint32_t nbits) const
+{
+  int exponent;
+  double mantissa = std::frexp (snr, &exponent);
+  if (snr <= 0 || exponent < MIN_EXP || exponent >= MAX_EXP)
+    {
+      return m_inner->GetChunkSuccessRate (mode, txVector, snr, nbits);
+    }
+  const std::vector<double> &table = GetTable (mode, txVector);
+  double position = (2 * mantissa - 1) * STEPS;
+  uint32_t step = uint32_t (position);
+  uint32_t i = (exponent - MIN_EXP) * STEPS + step;
+  double logP = table[i] + (position - step) * (table[i + 1] - table[i]);
+  return std::exp (-double (nbits) * std::exp (logP));
+}
+
+} // namespace ns3
+
+#endif /* TABLE_ERROR_RATE_MODEL_H */
@@ -0,0 +1,254 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef THROUGHPUT_SAMPLER_H
+#define THROUGHPUT_SAMPLER_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/applications-module.h"
+#include <stdint.h>
+#include <algorithm>
+#include <ostream>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief Periodic received-bytes samples of many PacketSinks.
+ *
+ * One scheduled event per interval reads the GetTotalRx () of every sink and
+ * stores the bytes received during the interval in a ring buffer allocated
+ * once, by Start (); the buffer keeps the most recent samples, one row per
+ * interval and one column per sink.  A sampler that is never started
+ * schedules nothing and costs nothing.
+ */
+class ThroughputSampler
+{
+public:
+  ThroughputSampler ();
+
+  /// Add one sink; its column index is the number of sinks added before it.
+  void Add (Ptr<PacketSink> sink);
+  /// Add every application of the container, which must all be PacketSinks.
+  void Add (ApplicationContainer sinks);
+
+  /**
+   * \param interval time between samples
+   * \param capacity number of samples kept; older ones are overwritten
+   */
+  void Configure (Time interval, uint32_t capacity);
+
+  /// Take the first sample one interval after delay from now.
+  void Start (Time delay);
+  /// Cancel the pending sample.
+  void Stop (void);
+
+  uint32_t GetNSinks (void) const;
+  Time GetInterval (void) const;
+  /// \return the number of samples held, at most the capacity
+  uint32_t GetNSamples (void) const;
+  /// \return the time sample k was taken, 0 being the oldest held
+  Time GetSampleTime (uint32_t k) const;
+  /// \return the bytes sink received during the interval ending at sample k
+  uint64_t GetRxBytes (uint32_t k, uint32_t sink) const;
+  /// \return the throughput of sink over the interval ending at sample k, in bit/s
+  double GetThroughput (uint32_t k, uint32_t sink) const;
+  /**
+   * \param sink the sink's column
+   * \param window number of most recent samples to average over
+   * \return the throughput of the sink over that window, in bit/s
+   */
+  double GetWindowThroughput (uint32_t sink, uint32_t window) const;
+
+  /// Print "time,sink0,sink1,...,total" lines, throughputs in Mbit/s.
+  void Print (std::ostream &os) const;
+
+private:
+  void Sample (void);
+  uint32_t Slot (uint32_t k) const;
+
+  std::vector<Ptr<PacketSink> > m_sinks;
+  std::vector<uint64_t> m_lastRx;
+  std::vector<uint64_t> m_ring;     //!< capacity x nSinks bytes, row per sample
+  std::vector<int64_t> m_times;     //!< sample times, as time steps
+  Time m_interval;
+  uint32_t m_capacity;
+  uint32_t m_next;                  //!< ring slot the next sample goes to
+  uint32_t m_count;                 //!< samples held
+  EventId m_event;
+};
+
+inline
+ThroughputSampler::ThroughputSampler ()
+  : m_interval (MilliSeconds (100)),
+    m_capacity (0),
+    m_next (0),
+    m_count (0)
+{
+}
+
+inline void
+ThroughputSampler::Add (Ptr<PacketSink> sink)
+{
+  NS_ASSERT (sink != 0);
+  m_sinks.push_back (sink);
+}
+
+inline void
+ThroughputSampler::Add (ApplicationContainer sinks)
+{
+  for (ApplicationContainer::Iterator i = sinks.Begin (); i != sinks.End (); ++i)
+    {
+      Add (DynamicCast<PacketSink> (*i));
+    }
+}
+
+inline void
+ThroughputSampler::Configure (Time interval, uint32_t capacity)
+{
+  NS_ABORT_MSG_IF (!interval.IsStrictlyPositive () || capacity == 0, "ThroughputSampler: bad configuration");
+  m_interval = interval;
+  m_capacity = capacity;
+}
+
+inline void
+ThroughputSampler::Start (Time delay)
+{
+  NS_ABORT_MSG_IF (m_capacity == 0, "ThroughputSampler: Configure () before Start ()");
+  m_ring.assign (m_capacity * m_sinks.size (), 0);
+  m_times.assign (m_capacity, 0);
+  m_lastRx.assign (m_sinks.size (), 0);
+  for (uint32_t i = 0; i < m_sinks.size (); ++i)
+    {
+      m_lastRx[i] = m_sinks[i]->GetTotalRx ();
+    }
+  m_next = 0;
+  m_count = 0;
+  m_event = Simulator::Schedule (delay + m_interval, &ThroughputSampler::Sample, this);
+}
+
+inline void
+ThroughputSampler::Stop (void)
+{
+  Simulator::Cancel (m_event);
+}
+
+inline void
+ThroughputSampler::Sample (void)
+{
+  uint64_t *row = m_sinks.empty () ? 0 : &m_ring[m_next * m_sinks.size ()];
+  for (uint32_t i = 0; i < m_sinks.size (); ++i)
+    {
+      uint64_t rx = m_sinks[i]->GetTotalRx ();
+      row[i] = rx - m_lastRx[i];
+      m_lastRx[i] = rx;
+    }
+  m_times[m_next] = Simulator::Now ().GetTimeStep ();
+  m_next = (m_next + 1) % m_capacity;
+  if (m_count < m_capacity)
+    {
+      m_count++;
+    }
+  m_event = Simulator::Schedule (m_interval, &ThroughputSampler::Sample, this);
+}
+
+inline uint32_t
+ThroughputSampler::Slot (uint32_t k) const
+{
+  NS_ASSERT (k < m_count);
+  return (m_next + m_capacity - m_count + k) % m_capacity;
+}
+
+inline uint32_t
+ThroughputSampler::GetNSinks (void) const
+{
+  return m_sinks.size ();
+}
+
+inline Time
+ThroughputSampler::GetInterval (void) const
+{
+  return m_interval;
+}
+
+inline uint32_t
+ThroughputSampler::GetNSamples (void) const
+{
+  return m_count;
+}
+
+inline Time
+ThroughputSampler::GetSampleTime (uint32_t k) const
+{
+  return TimeStep (m_times[Slot (k)]);
+}
+
+inline uint64_t
+ThroughputSampler::GetRxBytes (uint32_t k, uint32_t sink) const
+{
+  NS_ASSERT (sink < m_sinks.size ());
+  return m_ring[Slot (k) * m_sinks.size () + sink];
+}
+
+inline double
+ThroughputSampler::GetThroughput (uint32_t k, uint32_t sink) const
+{
+  return GetRxBytes (k, sink) * 8.0 / m_interval.GetSeconds ();
+}
+
+inline double
+ThroughputSampler::GetWindowThroughput (uint32_t sink, uint32_t window) const
+{
+  window = std::min (window, m_count);
+  if (window == 0)
+    {
+      return 0;
+    }
+  uint64_t bytes = 0;
+  for (uint32_t k = m_count - window; k < m_count; ++k)
+    {
+      bytes += GetRxBytes (k, sink);
+    }
+  return bytes * 8.0 / (window * m_interval.GetSeconds ());
+}
+
+inline void
+ThroughputSampler::Print (std::ostream &os) const
+{
+  os << "time";
+  for (uint32_t i = 0; i < m_sinks.size (); ++i)
+    {
+      os << ",sink" << i;
+    }
+  os << ",total\n";
+  for (uint32_t k = 0; k < m_count; ++k)
+    {
+      os << GetSampleTime (k).GetSeconds ();
+      double total = 0;
+      for (uint32_t i = 0; i < m_sinks.size (); ++i)
+        {
+          double mbps = GetThroughput (k, i) / 1e6;
+          total += mbps;
+          os << "," << mbps;
+        }
+      os << "," << total << "\n";
+    }
+}
+
+} // namespace ns3
+
+#endif /* THROUGHPUT_SAMPLER_H */
@@ -0,0 +1,275 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef TRAFFIC_MATRIX_H
+#define TRAFFIC_MATRIX_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/applications-module.h"
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief Offered load between every ordered pair of nodes, in bit/s.
+ *
+ * Entry (src, dst) is the rate node src sends to node dst; a zero entry
+ * means no flow.  The matrix is stored flat, row by row.
+ *
+ * The text form, read by Load and written by Save, has one flow per line,
+ * "src dst rateMbps", with '#' starting a comment.
+ */
+class TrafficMatrix
+{
+public:
+  /// \param nNodes number of nodes; every entry starts at zero
+  TrafficMatrix (uint32_t nNodes = 0);
+
+  /**
+   * \param nNodes number of nodes
+   * \param totalRate offered load of the whole matrix, in bit/s
+   * \return every ordered pair of distinct nodes with an equal share
+   */
+  static TrafficMatrix AllPairs (uint32_t nNodes, double totalRate);
+
+  /// Read a matrix from its text form; aborts on a malformed file.
+  static TrafficMatrix Load (const std::string &path, uint32_t nNodes);
+  /// Write the non-zero entries in text form.
+  void Save (const std::string &path) const;
+
+  uint32_t GetNNodes (void) const;
+  /// \return the rate from src to dst, in bit/s
+  double Get (uint32_t src, uint32_t dst) const;
+  /// Set the rate from src to dst, in bit/s.
+  void Set (uint32_t src, uint32_t dst, double rate);
+
+  /// \return the sum of all entries, in bit/s
+  double GetTotal (void) const;
+  /// Multiply every entry by factor.
+  void Scale (double factor);
+
+private:
+  uint32_t m_nNodes;
+  std::vector<double> m_rates;
+};
+
+/**
+ * \brief Installs one OnOffApplication per non-zero traffic matrix entry.
+ *
+ * The attributes shared by every flow are set once on the installer and
+ * checked once; each flow then only gets its remote address and its rate,
+ * both as ready-made values.  This replaces one OnOffHelper, four attribute
+ * strings and a formatted "xMbps" rate per pair.
+ */
+class TrafficMatrixInstaller
+{
+public:
+  /**
+   * \param protocol the socket factory, e.g. "ns3::TcpSocketFactory"
+   * \param port the port the sinks listen on
+   */
+  TrafficMatrixInstaller (std::string protocol, uint16_t port);
+
+  /// Set an attribute of every OnOffApplication to be installed.
+  void SetAttribute (std::string name, const AttributeValue &value);
+
+  /**
+   * \param matrix the offered load
+   * \param nodes node i of the matrix is nodes.Get (i)
+   * \param interfaces the address of node i is interfaces.GetAddress (i)
+   * \return the applications, in row order
+   */
+  ApplicationContainer Install (const TrafficMatrix &matrix, NodeContainer nodes,
+                                const Ipv4InterfaceContainer &interfaces) const;
+
+private:
+  ObjectFactory m_factory;
+  uint16_t m_port;
+};
+
+inline
+TrafficMatrix::TrafficMatrix (uint32_t nNodes)
+  : m_nNodes (nNodes),
+    m_rates (nNodes * nNodes, 0.0)
+{
+}
+
+inline TrafficMatrix
+TrafficMatrix::AllPairs (uint32_t nNodes, double totalRate)
+{
+  TrafficMatrix matrix (nNodes);
+  if (nNodes < 2)
+    {
+      return matrix;
+    }
+  double share = totalRate / (nNodes * (nNodes - 1));
+  for (uint32_t src = 0; src < nNodes; ++src)
+    {
+      for (uint32_t dst = 0; dst < nNodes; ++dst)
+        {
+          if (src != dst)
+            {
+              matrix.m_rates[src * nNodes + dst] = share;
+            }
+        }
+    }
+  return matrix;
+}
+
+inline TrafficMatrix
+TrafficMatrix::Load (const std::string &path, uint32_t nNodes)
+{
+  std::ifstream in (path.c_str ());
+  NS_ABORT_MSG_IF (!in, "TrafficMatrix: cannot open " << path);
+  TrafficMatrix matrix (nNodes);
+  std::string line;
+  uint32_t lineNo = 0;
+  while (std::getline (in, line))
+    {
+      ++lineNo;
+      line = line.substr (0, line.find ('#'));
+      std::istringstream fields (line);
+      uint32_t src, dst;
+      double mbps;
+      if (!(fields >> src))
+        {
+          continue;
+        }
+      NS_ABORT_MSG_IF (!(fields >> dst >> mbps), path << ":" << lineNo << ": expected \"src dst rateMbps\"");
+      NS_ABORT_MSG_IF (src >= nNodes || dst >= nNodes, path << ":" << lineNo << ": node out of range, "
+                       << nNodes << " nodes");
+      matrix.Set (src, dst, mbps * 1e6);
+    }
+  return matrix;
+}
+
+inline void
+TrafficMatrix::Save (const std::string &path) const
+{
+  std::ofstream out (path.c_str ());
+  out << "# src dst rateMbps\n";
+  for (uint32_t src = 0; src < m_nNodes; ++src)
+    {
+      for (uint32_t dst = 0; dst < m_nNodes; ++dst)
+        {
+          double rate = m_rates[src * m_nNodes + dst];
+          if (rate > 0)
+            {
+              out << src << " " << dst << " " << rate / 1e6 << "\n";
+            }
+        }
+    }
+}
+
+inline uint32_t
+TrafficMatrix::GetNNodes (void) const
+{
+  return m_nNodes;
+}
+
+inline double
+TrafficMatrix::Get (uint32_t src, uint32_t dst) const
+{
+  NS_ASSERT (src < m_nNodes && dst < m_nNodes);
+  return m_rates[src * m_nNodes + dst];
+}
+
+inline void
+TrafficMatrix::Set (uint32_t src, uint32_t dst, double rate)
+{
+  NS_ASSERT (src < m_nNodes && dst < m_nNodes);
+  m_rates[src * m_nNodes + dst] = rate;
+}
+
+inline double
+TrafficMatrix::GetTotal (void) const
+{
+  double total = 0;
+  for (std::vector<double>::const_iterator i = m_rates.begin (); i != m_rates.end (); ++i)
+    {
+      total += *i;
+    }
+  return total;
+}
+
+inline void
+TrafficMatrix::Scale (double factor)
+{
+  for (std::vector<double>::iterator i = m_rates.begin (); i != m_rates.end (); ++i)
+    {
+      *i *= factor;
+    }
+}
+
+inline
+TrafficMatrixInstaller::TrafficMatrixInstaller (std::string protocol, uint16_t port)
+  : m_port (port)
+{
+  m_factory.SetTypeId ("ns3::OnOffApplication");
+  m_factory.Set ("Protocol", StringValue (protocol));
+}
+
+inline void
+TrafficMatrixInstaller::SetAttribute (std::string name, const AttributeValue &value)
+{
+  m_factory.Set (name, value);
+}
+
+inline ApplicationContainer
+TrafficMatrixInstaller::Install (const TrafficMatrix &matrix, NodeContainer nodes,
+                                 const Ipv4InterfaceContainer &interfaces) const
+{
+  uint32_t n = matrix.GetNNodes ();
+  NS_ABORT_MSG_IF (n > nodes.GetN () || n > interfaces.GetN (),
+                   "TrafficMatrixInstaller: " << n << " x " << n << " matrix for "
+                   << nodes.GetN () << " nodes");
+
+  std::vector<AddressValue> remotes;
+  remotes.reserve (n);
+  for (uint32_t dst = 0; dst < n; ++dst)
+    {
+      remotes.push_back (AddressValue (InetSocketAddress (interfaces.GetAddress (dst), m_port)));
+    }
+
+  ApplicationContainer apps;
+  for (uint32_t src = 0; src < n; ++src)
+    {
+      Ptr<Node> node = nodes.Get (src);
+      for (uint32_t dst = 0; dst < n; ++dst)
+        {
+          double rate = matrix.Get (src, dst);
+          if (rate <= 0)
+            {
+              continue;
+            }
+          Ptr<Application> app = m_factory.Create<Application> ();
+          app->SetAttribute ("Remote", remotes[dst]);
+          app->SetAttribute ("DataRate", DataRateValue (DataRate (static_cast<uint64_t> (rate + 0.5))));
+          node->AddApplication (app);
+          apps.Add (app);
+        }
+    }
+  return apps;
+}
+
+} // namespace ns3
+
+#endif /* TRAFFIC_MATRIX_H */
@@ -54,77 +54,68 @@
 #include <vector>
 #include <stdint.h>
 #include <sstream>
+#include <cmath>
 #include <fstream>
 #include<time.h>
  #include<math.h>
 #include "ns3/point-to-point-module.h"
 #include "ns3/flow-monitor-module.h"
+#include "sweep-runner.h"
+#include "knee-search.h"
+#include "steady-state-detector.h"
+#include "sample-stats.h"
+#include "scenario-template.h"
+#include "traffic-matrix.h"
+#include "flow-index.h"
+#include "throughput-sampler.h"
+#include "async-pcap-writer.h"
+#include "benchmark-report.h"
+#include "simulator-profiler.h"
+#include "ladder-scheduler.h"
+/* This program replaces operator new with the pool (packet-pool.h). */
+#define PACKET_POOL_REPLACE_NEW
+#include "packet-pool.h"
 
 using namespace ns3;
 
+uint32_t nWifis = 1;
+uint32_t nStas = 8;                                /* Stations per wifi network. */
+bool sendIp = true;
+bool writeMobility = false;
+uint32_t replications = 1;                         /* Independent runs per load point. */
+uint32_t firstRun = 1;                             /* RngRun of the first replica. */
+uint32_t payloadSize = 1472;                       /* Transport layer payload size in bytes. */
+double simulationTime = 5;                         /* Simulation time in seconds. */
+ScenarioTemplate scenario;                         /* The BSS every load point runs on. */
+bool warmupFork = true;                            /* Fork the load points after the 1 s warm-up. */
+std::string trafficMatrix;                         /* Relative load per STA pair, empty for all pairs. */
+uint32_t sampleInterval = 0;                       /* Per-STA throughput sampling period in ms, 0 disables it. */
+double loadStep = 0.1;                             /* Distance between load points, from 10% to 90% of 11 Mbps. */
+bool adaptive = false;                             /* Bisect to the saturation knee instead of running every point. */
+std::vector<uint32_t> loadPoints;                  /* Grid point of each job of the current sweep. */
+bool steadyState = false;                          /* Stop a run once its metrics have converged. */
+double ciTarget = 0.05;                            /* Relative confidence half width that counts as converged. */
+double minTime = 1;                                /* Seconds a steady-state run lasts at least. */
 
-int getindex(int i)
-{
-  if(i<10)
-  {
-    return i-2;
-  }
-  else
-  {
-    return i-3;
-  }
-}
 
-int main (int argc, char *argv[])
+/*
+ * Builds the load-independent part of the scenario: the bridged APs and
+ * their stations, with mobility, Internet stacks and addresses. It runs once
+ * per replication, in the parent, and every load point starts from its result.
+ */
+void
+BuildBss (BssTopology &bss)
 {
-  for(double percent=0.1;percent<=0.9;percent+=0.1){
-  uint32_t nWifis = 1;
-  uint32_t nStas[1]={8};
-  //uint32_t nStas = 2;
-  bool sendIp = true;
-  bool writeMobility = false;
-  
-  double totalrate=11.0*percent;
-
-  uint32_t payloadSize = 1472;                       /* Transport layer payload size in bytes. */
-  std::string dataRate = "1Mbps";                  /* Application layer datarate. */
-  std::string tcpVariant = "ns3::TcpNewReno";        /* TCP variant type. */
-  std::string phyRate = "HtMcs7";                    /* Physical layer bitrate. */
-  double simulationTime = 5;                        /* Simulation time in seconds. */
-  // bool pcapTracing = true;                          /* PCAP Tracing is enabled or not. */
-
-  /* No fragmentation and no RTS/CTS */
-  Config::SetDefault ("ns3::WifiRemoteStationManager::FragmentationThreshold", StringValue ("999999"));
-  // Config::SetDefault ("ns3::WifiRemoteStationManager::RtsCtsThreshold", StringValue ("1000"));
-  // ns3::FlowMonitorHelper
-
-  /* Configure TCP Options */
-  Config::SetDefault ("ns3::TcpSocket::SegmentSize", UintegerValue (payloadSize));
-
-  // WifiAddPropagationLoss ("ns3::LogDistancePropagationLossModel", "Exponent", DoubleValue (3.0), "ReferenceLoss", DoubleValue (40.0459));
-
   std::string phyMode ("DsssRate11Mbps");
 
-  CommandLine cmd;
-  cmd.AddValue ("nWifis", "Number of wifi networks", nWifis);
-  // cmd.AddValue ("nStas", "Number of stations per wifi network", nStas);
-  cmd.AddValue ("SendIp", "Send Ipv4 or raw packets", sendIp);
-  cmd.AddValue ("writeMobility", "Write mobility trace", writeMobility);
-  cmd.Parse (argc, argv);
-
-  NodeContainer backboneNodes;
+  NodeContainer &backboneNodes = bss.ap;
   NetDeviceContainer backboneDevices;
-  Ipv4InterfaceContainer backboneInterfaces;
-  std::vector<NodeContainer> staNodes;
-  std::vector<NetDeviceContainer> staDevices;
-  std::vector<NetDeviceContainer> apDevices;
-  std::vector<Ipv4InterfaceContainer> staInterfaces;
-  std::vector<Ipv4InterfaceContainer> apInterfaces;
 
   InternetStackHelper stack;
   CsmaHelper csma;
   Ipv4AddressHelper ip;
-  ip.SetBase ("192.168.0.0", "255.255.255.0");
+  /* A /16, so that a BSS can hold more than 253 stations. */
+  ip.SetBase ("192.168.0.0", "255.255.0.0");
 
   backboneNodes.Create (nWifis);
   stack.Install (backboneNodes);
@@ -133,8 +124,8 @@ int main (int argc, char *argv[])
 
   double wifiX = 0.0;
 
-  YansWifiPhyHelper wifiPhy = YansWifiPhyHelper::Default ();
-  wifiPhy.SetPcapDataLinkType (YansWifiPhyHelper::DLT_IEEE802_11_RADIO); 
+  bss.phy = YansWifiPhyHelper::Default ();
+  bss.phy.SetPcapDataLinkType (YansWifiPhyHelper::DLT_IEEE802_11_RADIO); 
 
   for (uint32_t i = 0; i < nWifis; ++i)
     {
@@ -168,13 +159,21 @@ int main (int argc, char *argv[])
       NqosWifiMacHelper wifiMac = NqosWifiMacHelper::Default();
 
 
-      sta.Create (nStas[i]);
+      /*
+       * The AP and its stations fill a square grid 5 m apart, AP in the
+       * corner, so that 256 stations stay within about 115 m of it: with
+       * the log-distance loss (reference 40.05 dB, exponent 3) at 16 dBm a
+       * station much farther than 150 m cannot associate.
+       */
+      sta.Create (nStas);
+      uint32_t gridWidth = (uint32_t) std::ceil (std::sqrt (nStas + 1.0));
+      uint32_t gridRows = (nStas + gridWidth) / gridWidth;
       mobility.SetPositionAllocator ("ns3::GridPositionAllocator",
                                      "MinX", DoubleValue (wifiX),
                                      "MinY", DoubleValue (0.0),
                                      "DeltaX", DoubleValue (5.0),
                                      "DeltaY", DoubleValue (5.0),
-                                     "GridWidth", UintegerValue (1),
+                                     "GridWidth", UintegerValue (gridWidth),
                                      "LayoutType", StringValue ("RowFirst"));
 
 
@@ -197,7 +196,7 @@ int main (int argc, char *argv[])
                                  "Mode", StringValue ("Time"),
                                  "Time", StringValue ("2s"),
                                  "Speed", StringValue ("ns3::ConstantRandomVariable[Constant=1.0]"),
-                                 "Bounds", RectangleValue (Rectangle (wifiX, wifiX+5.0,0.0, (nStas[i]+1)*5.0)));
+                                 "Bounds", RectangleValue (Rectangle (wifiX, wifiX + gridWidth * 5.0, 0.0, gridRows * 5.0)));
       mobility.Install (sta);
       wifiMac.SetType ("ns3::StaWifiMac",
                        "Ssid", SsidValue (ssid));
@@ -205,72 +204,52 @@ int main (int argc, char *argv[])
       staInterface = ip.Assign (staDev);
 
       // save everything in containers.
-      staNodes.push_back (sta);
-      apDevices.push_back (apDev);
-      apInterfaces.push_back (apInterface);
-      staDevices.push_back (staDev);
-      staInterfaces.push_back (staInterface);
+      bss.sta.Add (sta);
+      bss.apDevices.Add (apDev);
+      bss.apInterfaces.Add (apInterface);
+      bss.staDevices.Add (staDev);
+      bss.staInterfaces.Add (staInterface);
 
-      wifiX += 20.0;
+      wifiX += gridWidth * 5.0 + 15.0;
     }
+}
 
+/*
+ * Runs one load point of the current replication on the prebuilt BSS and
+ * returns "percent throughput delay jitter" for the replication summary.
+ */
+std::string
+RunLoadPoint (uint32_t point)
+{
+  double percent = 0.1 + loadPoints[point] * loadStep;
+  uint32_t run = RngSeedManager::GetRun ();
 
+  std::ostringstream tag;
+  tag << "-" << (int) (percent * 100 + 0.5) << "-r" << run;
 
+  double totalrate=11.0*percent;
 
-  /* Populate routing table */
-  // Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
-
+  const BssTopology &bss = scenario.GetTopology ();
 
   /* Install TCP Receiver on the access point */
   PacketSinkHelper sinkHelper ("ns3::TcpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), 9));
-  ApplicationContainer sinkApp = sinkHelper.Install (staNodes[0]);  
+  ApplicationContainer sinkApp = sinkHelper.Install (bss.sta);  
   
   // sink = StaticCast<PacketSink> (sinkApp.Get(0));
 
   /* Install TCP/UDP Transmitter on the station */  
-  ApplicationContainer serverApp;//1,serverApp2;
-  srand(time(NULL));
-
-  
-  double arr[56];
-  double sum=0.0;
-  for(int i=0;i<56;i++)
-  {
-    arr[i]=rand()%20+10;
-    sum+=arr[i];
-  }
-  // int count=0;
-  double anss=0.0;
-  for(int sender=0;sender<8;sender++)
-  {
-
-     
-    for(int rcv=0;rcv<8;rcv++)
-    {
-        
-        if(sender==rcv) continue;
-        double valself=(totalrate*1.0)/56.0;
-        anss+=valself;
-        OnOffHelper server ("ns3::TcpSocketFactory", (InetSocketAddress (staInterfaces[0].GetAddress (rcv), 9)));
-        server.SetAttribute ("PacketSize", UintegerValue (payloadSize));
-        server.SetAttribute ("OnTime", StringValue ("ns3::ConstantRandomVariable[Constant=1]"));
-        server.SetAttribute ("OffTime", StringValue ("ns3::ConstantRandomVariable[Constant=0]"));
-        server.SetAttribute ("DataRate", DataRateValue (DataRate (std::to_string(valself)+"Mbps")));
-        serverApp.Add(server.Install(staNodes[0].Get(sender)));    
-    }
-    
-    
-  }
-std::cout<<"fasfas "<<anss<<std::endl;
-
-
-  
-    
-  
-
+  TrafficMatrix matrix = trafficMatrix.empty () ? TrafficMatrix::AllPairs (bss.sta.GetN (), 1.0)
+                                                : TrafficMatrix::Load (trafficMatrix, bss.sta.GetN ());
+  NS_ABORT_MSG_IF (matrix.GetTotal () <= 0, "Traffic matrix " << trafficMatrix << " has no flows");
+  matrix.Scale (totalrate * 1e6 / matrix.GetTotal ());
+  TrafficMatrixInstaller server ("ns3::TcpSocketFactory", 9);
+  server.SetAttribute ("PacketSize", UintegerValue (payloadSize));
+  server.SetAttribute ("OnTime", StringValue ("ns3::ConstantRandomVariable[Constant=1]"));
+  server.SetAttribute ("OffTime", StringValue ("ns3::ConstantRandomVariable[Constant=0]"));
+  ApplicationContainer serverApp = server.Install (matrix, bss.sta, bss.staInterfaces);
 
   sinkApp.Start (Seconds (0.0));
-  serverApp.Start (Seconds (1.0));
+  serverApp.Start (ScenarioTemplate::Until (Seconds (1.0)));
 
 
 
@@ -281,31 +260,59 @@ std::cout<<"fasfas "<<anss<<std::endl;
        
 
   Ptr<FlowMonitor> flowMonitor = flowHelper.InstallAll();
+
+  /* With --steadyState the run ends once the batch means of throughput and delay have converged. */
+  SteadyStateDetector detector;
+  if (steadyState)
+    {
+      detector.Add (sinkApp);
+      detector.SetFlowMonitor (flowMonitor);
+      detector.Configure (MilliSeconds (100), Seconds (minTime), ciTarget);
+      detector.Start (ScenarioTemplate::Until (Seconds (1.0)));
+    }
   
   
 
-  wifiPhy.EnablePcap ("wifi-wired-bridging", apDevices[0]);
+  AsyncPcapWriter pcap;
+  pcap.EnableWifi ("wifi-wired-bridging" + tag.str (), NetDeviceContainer (bss.apDevices.Get (0)));
   
 
   
-  Simulator::Stop (Seconds (simulationTime + 1));
-  Simulator::Run ();
+  /* Per-STA throughput curves, one sample of every sink per interval. */
+  ThroughputSampler sampler;
+  if (sampleInterval > 0)
+    {
+      sampler.Add (sinkApp);
+      sampler.Configure (MilliSeconds (sampleInterval), (uint32_t) (simulationTime * 1000 / sampleInterval) + 1);
+      sampler.Start (ScenarioTemplate::Until (Seconds (1.0)));
+    }
 
+  Simulator::Stop (ScenarioTemplate::Until (Seconds (simulationTime + 1)));
+  Simulator::Run ();
+  pcap.Close ();
+  /* The time the sources ran, the rates are averaged over. */
+  double duration = steadyState ? detector.GetElapsed ().GetSeconds () : simulationTime;
 
-  double matrix[8][8];
-  for(int i=0;i<8;i++)
-  {
-    for(int j=0;j<8;j++)
+  if (sampleInterval > 0)
     {
-      matrix[i][j]=0.0;
+      std::ofstream curves (("throughput" + tag.str () + ".csv").c_str ());
+      sampler.Print (curves);
     }
-  }
-  
+
+
+  /* Throughput between every pair of stations, indexed in station order. */
+  NodeIndexMap stationIndex;
+  stationIndex.Add (bss.staInterfaces);
+  FlowMatrix matrix (stationIndex.GetN ());
+
   flowMonitor->CheckForLostPackets ();
   Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier> (flowHelper.GetClassifier ());
   std::map<FlowId, FlowMonitor::FlowStats> stats = flowMonitor->GetFlowStats ();
   // double tput_1=0;
   // double tput_2=0;
+  double delaySum=0.0;
+  double jitterSum=0.0;
+  double rxPackets=0.0;
 
   for (std::map<FlowId, FlowMonitor::FlowStats>::const_iterator iter = stats.begin (); iter != stats.end (); ++iter){
     // cout<<iter->first;
@@ -314,10 +321,8 @@ std::cout<<"fasfas "<<anss<<std::endl;
       Ipv4FlowClassifier::FiveTuple t = classifier->FindFlow (iter->first);
 
       
-      uint32_t saddress=t.sourceAddress.Get();
-      int index1=getindex(saddress%3232235520);
-      uint32_t daddress=t.destinationAddress.Get();
-      int index2=getindex(daddress%3232235520);
+      int32_t index1=stationIndex.Lookup (t.sourceAddress);
+      int32_t index2=stationIndex.Lookup (t.destinationAddress);
 
       
 
@@ -330,8 +335,16 @@ std::cout<<"fasfas "<<anss<<std::endl;
       
       // NS_LOG_UNCOND("DelaySum = " << iter->second.delaySum);
 
-      double tput=iter->second.rxBytes * 8.0 / (iter->second.timeLastRxPacket.GetSeconds()-iter->second.timeFirstTxPacket.GetSeconds()) / 1024 ;
-      matrix[index1][index2]+=tput;
+      /* A flow that delivered nothing has no receive time to divide by. */
+      double tput = iter->second.rxPackets > 0 && iter->second.timeLastRxPacket > iter->second.timeFirstTxPacket
+        ? iter->second.rxBytes * 8.0 / (iter->second.timeLastRxPacket.GetSeconds()-iter->second.timeFirstTxPacket.GetSeconds()) / 1024 : 0;
+      if (index1 >= 0 && index2 >= 0)
+        {
+          matrix.Add (index1, index2, tput);
+        }
+      delaySum+=iter->second.delaySum.GetSeconds();
+      jitterSum+=iter->second.jitterSum.GetSeconds();
+      rxPackets+=iter->second.rxPackets;
       // NS_LOG_UNCOND("Throughput: " << tput << " Kbps");
      
       // th_put[index]=tput;
@@ -351,17 +364,11 @@ NS_LOG_UNCOND("\n\nReport\n\n");
 
 
       
-double totalsum=0.0;
-
-for(int i=0;i<8;i++)
-{
-  for(int j=0;j<8;j++)
+double totalsum=matrix.GetTotal ();
+if (matrix.GetN () <= 16)
   {
-    totalsum+=matrix[i][j];
-    std::cout<<matrix[i][j]<<" ";
+    matrix.Print (std::cout);
   }
-  std::cout<<std::endl;
-}
 
 
 
@@ -375,16 +382,159 @@ std::cout<<"network1 : "<<percent*100<<" "<<ans<< std::endl;
 // flowMonitor->SerializeToXmlFile("report1.xml", true, true);
   
 double throughput = 0;
-          uint32_t totalPacketsThrough = 0;
-          for(int ii = 0; ii<8; ii++){
+          uint64_t totalPacketsThrough = 0;
+          for(uint32_t ii = 0; ii<sinkApp.GetN (); ii++){
             totalPacketsThrough  =  totalPacketsThrough +  DynamicCast<PacketSink> (sinkApp.Get (ii))->GetTotalRx ();
           }
 
-          throughput = totalPacketsThrough * 8 / (simulationTime * 1000000.0); //Mbit/s
+          throughput = totalPacketsThrough * 8 / (duration * 1000000.0); //Mbit/s
           std::cout << throughput << " Mbit/s" <<std::endl;
   Simulator::Destroy ();
+
+  std::ostringstream result;
+  result << percent * 100 << " " << throughput << " "
+         << (rxPackets > 0 ? delaySum / rxPackets : 0) << " "
+         << (rxPackets > 1 ? jitterSum / (rxPackets - 1) : 0) << "\n";
+  return result.str ();
 }
-  
+
+int main (int argc, char *argv[])
+{
+  uint32_t jobs = 0;
+  std::string benchmark;
+  bool recordBenchmark = false;
+  bool profile = false;
+  std::string scheduler = "map";
+  bool packetPool = true;
+
+  CommandLine cmd;
+  cmd.AddValue ("nWifis", "Number of wifi networks", nWifis);
+  cmd.AddValue ("nStas", "Number of stations per wifi network", nStas);
+  cmd.AddValue ("SendIp", "Send Ipv4 or raw packets", sendIp);
+  cmd.AddValue ("writeMobility", "Write mobility trace", writeMobility);
+  cmd.AddValue ("replications", "Independent runs (RngRun values) per load point", replications);
+  cmd.AddValue ("loadStep", "Offered load step between points, as a fraction of 11 Mbps", loadStep);
+  cmd.AddValue ("adaptive", "Run a coarse sweep and bisect to the saturation knee at loadStep resolution", adaptive);
+  cmd.AddValue ("steadyState", "Stop each run once throughput and delay have converged (simulationTime is then the maximum)", steadyState);
+  cmd.AddValue ("ciTarget", "Steady state: 95% confidence half width of the batch means, relative to the mean", ciTarget);
+  cmd.AddValue ("minTime", "Steady state: simulated seconds to run at least", minTime);
+  cmd.AddValue ("warmupFork", "Simulate the first second once and fork every load point from it", warmupFork);
+  cmd.AddValue ("trafficMatrix", "Traffic matrix file, one \"src dst weight\" per line, scaled to the offered load (default: all pairs)", trafficMatrix);
+  cmd.AddValue ("sampleInterval", "Per-STA throughput sampling period in ms, written to throughput-<load>-r<run>.csv (0: off)", sampleInterval);
+  cmd.AddValue ("jobs", "Number of simulations run in parallel (0: one per core)", jobs);
+  cmd.AddValue ("benchmark", "Check the run against this bands file", benchmark);
+  cmd.AddValue ("recordBenchmark", "Write the --benchmark bands file from this run instead of checking it", recordBenchmark);
+  cmd.AddValue ("profile", "Print the simulator profile (events, queue depth, cost per callback) of every simulation", profile);
+  cmd.AddValue ("scheduler", "Event scheduler: map, heap, list, calendar or ladder", scheduler);
+  cmd.AddValue ("packetPool", "Recycle the packet, tag, event and callback allocations through per-thread free lists", packetPool);
+  cmd.Parse (argc, argv);
+
+  PacketPool::Enable (packetPool);
+
+  SelectScheduler (scheduler);
+  BenchmarkReport report ("wifi-singleap");
+  if (!benchmark.empty ())
+    {
+      report.Start ();
+    }
+  if (profile)
+    {
+      ProfilingScheduler::Enable ();
+    }
+
+  /* --RngRun selects the run number of the first replica. */
+  firstRun = RngSeedManager::GetRun ();
+
+  /* No fragmentation and no RTS/CTS */
+  Config::SetDefault ("ns3::WifiRemoteStationManager::FragmentationThreshold", StringValue ("999999"));
+  // Config::SetDefault ("ns3::WifiRemoteStationManager::RtsCtsThreshold", StringValue ("1000"));
+  // ns3::FlowMonitorHelper
+
+  /* Configure TCP Options */
+  Config::SetDefault ("ns3::TcpSocket::SegmentSize", UintegerValue (payloadSize));
+
+  // WifiAddPropagationLoss ("ns3::LogDistancePropagationLossModel", "Exponent", DoubleValue (3.0), "ReferenceLoss", DoubleValue (40.0459));
+
+  NS_ABORT_MSG_IF (!(loadStep > 0), "Bad load sweep: --loadStep=" << loadStep);
+  NS_ABORT_MSG_IF ((0.9 - 0.1) / loadStep > 10000, "Load sweep of more than 10000 points: raise --loadStep");
+  uint32_t nPoints = (uint32_t) ((0.9 - 0.1) / loadStep + 1e-9) + 1;
+  SweepRunner runner;
+  runner.SetMaxJobs (jobs);
+  scenario.SetBuilder (MakeCallback (&BuildBss));
+  if (warmupFork)
+    {
+      /* Nothing but association happens before the sources start at 1 s. */
+      scenario.SetWarmup (Seconds (1.0));
+    }
+  std::vector<std::string> results;
+  if (adaptive)
+    {
+      /* Rounds of points, each run in parallel, until the knee is one loadStep wide. */
+      KneeSearch search (nPoints, 4);
+      std::map<uint32_t, std::vector<std::string> > measured;
+      for (loadPoints = search.NextRound (); !loadPoints.empty (); loadPoints = search.NextRound ())
+        {
+          std::vector<std::string> round = scenario.Run (runner, firstRun, replications, loadPoints.size (), MakeCallback (&RunLoadPoint));
+          for (uint32_t k = 0; k < loadPoints.size (); ++k)
+            {
+              SampleStats delay, loss;
+              for (uint32_t r = 0; r < replications; ++r)
+                {
+                  double percent, t, d;
+                  std::istringstream in (round[k * replications + r]);
+                  in >> percent >> t >> d;
+                  delay.Add (d);
+                  /* TCP retransmits its losses: saturation shows as throughput short of the offered load. */
+                  loss.Add (std::max (0.0, 100 * (1 - t / (11.0 * percent / 100))));
+                }
+              search.Set (loadPoints[k], delay.GetMean (), loss.GetMean ());
+              measured[loadPoints[k]].assign (round.begin () + k * replications, round.begin () + (k + 1) * replications);
+            }
+        }
+      for (std::map<uint32_t, std::vector<std::string> >::iterator i = measured.begin (); i != measured.end (); ++i)
+        {
+          loadPoints.push_back (i->first);
+          results.insert (results.end (), i->second.begin (), i->second.end ());
+        }
+      std::cout << "Adaptive sweep: " << loadPoints.size () << " of " << nPoints << " load points" << std::endl;
+    }
+  else
+    {
+      for (uint32_t point = 0; point < nPoints; ++point)
+        {
+          loadPoints.push_back (point);
+        }
+      results = scenario.Run (runner, firstRun, replications, nPoints, MakeCallback (&RunLoadPoint));
+    }
+
+  std::cout << "load(%)\tthroughput(Mbit/s)\t+-CI95\tdelay(s)\t+-CI95\tjitter(s)\t+-CI95" << std::endl;
+  for (uint32_t point = 0; point < loadPoints.size (); ++point)
+    {
+      double percent = 0;
+      SampleStats throughput, delay, jitter;
+      for (uint32_t r = 0; r < replications; ++r)
+        {
+          double t, d, j;
+          std::istringstream in (results[point * replications + r]);
+          in >> percent >> t >> d >> j;
+          throughput.Add (t);
+          delay.Add (d);
+          jitter.Add (j);
+        }
+      std::cout << percent << "\t" << throughput.GetMean () << "\t" << throughput.GetConfidenceHalfWidth ()
+                << "\t" << delay.GetMean () << "\t" << delay.GetConfidenceHalfWidth ()
+                << "\t" << jitter.GetMean () << "\t" << jitter.GetConfidenceHalfWidth () << std::endl;
+      std::ostringstream load;
+      load << "-" << percent;
+      report.AddKpi ("throughput" + load.str (), throughput.GetMean ());
+      report.AddKpi ("delay" + load.str (), delay.GetMean ());
+    }
+
+  if (!benchmark.empty () && report.Finish (benchmark, recordBenchmark, std::cout) > 0)
+    {
+      return 1;
+    }
+  return 0;
 
 
 
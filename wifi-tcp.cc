@@ -39,6 +39,9 @@
 #include "ns3/network-module.h"
 #include "ns3/point-to-point-module.h"
 #include "ns3/wifi-module.h"
+#include "benchmark-report.h"
+#include "cached-loss-model.h"
+#include "table-error-rate-model.h"
 
 NS_LOG_COMPONENT_DEFINE ("wifi-tcp");
 
@@ -66,6 +69,10 @@ main(int argc, char *argv[])
   std::string phyRate = "HtMcs7";                    /* Physical layer bitrate. */
   double simulationTime = 10;                        /* Simulation time in seconds. */
   bool pcapTracing = false;                          /* PCAP Tracing is enabled or not. */
+  std::string benchmark = "scratch/wifi-tcp.bands";  /* Expected throughput band. */
+  bool recordBenchmark = false;                      /* Write the bands file instead of checking it. */
+  bool lossCache = true;                             /* Cache the path loss of the static node pair. */
+  bool errorTables = true;                           /* Error rates from precomputed SNR tables. */
 
   /* Command line argument parser setup. */
   CommandLine cmd;
@@ -75,8 +82,15 @@ main(int argc, char *argv[])
   cmd.AddValue ("phyRate", "Physical layer bitrate", phyRate);
   cmd.AddValue ("simulationTime", "Simulation time in seconds", simulationTime);
   cmd.AddValue ("pcap", "Enable/disable PCAP Tracing", pcapTracing);
+  cmd.AddValue ("lossCache", "Compute the path loss of the node pair once", lossCache);
+  cmd.AddValue ("errorTables", "Read the frame error rates from precomputed SNR tables", errorTables);
+  cmd.AddValue ("benchmark", "Expected throughput and performance bands to check the run against", benchmark);
+  cmd.AddValue ("recordBenchmark", "Write the --benchmark bands file from this run instead of checking it", recordBenchmark);
   cmd.Parse (argc, argv);
 
+  BenchmarkReport report ("wifi-tcp");
+  report.Start ();
+
   /* No fragmentation and no RTS/CTS */
   Config::SetDefault ("ns3::WifiRemoteStationManager::FragmentationThreshold", StringValue ("999999"));
   Config::SetDefault ("ns3::WifiRemoteStationManager::RtsCtsThreshold", StringValue ("999999"));
@@ -95,7 +109,12 @@ main(int argc, char *argv[])
 
   /* Setup Physical Layer */
   YansWifiPhyHelper wifiPhy = YansWifiPhyHelper::Default ();
-  wifiPhy.SetChannel (wifiChannel.Create ());
+  Ptr<YansWifiChannel> channel = wifiChannel.Create ();
+  if (lossCache)
+    {
+      CachedPropagationLossModel::Install (channel);
+    }
+  wifiPhy.SetChannel (channel);
   wifiPhy.Set ("TxPowerStart", DoubleValue (10.0));
   wifiPhy.Set ("TxPowerEnd", DoubleValue (10.0));
   wifiPhy.Set ("TxPowerLevels", UintegerValue (1));
@@ -104,7 +123,14 @@ main(int argc, char *argv[])
   wifiPhy.Set ("RxNoiseFigure", DoubleValue (10));
   wifiPhy.Set ("CcaMode1Threshold", DoubleValue (-79));
   wifiPhy.Set ("EnergyDetectionThreshold", DoubleValue (-79 + 3));
-  wifiPhy.SetErrorRateModel ("ns3::YansErrorRateModel");
+  if (errorTables)
+    {
+      wifiPhy.SetErrorRateModel ("ns3::TableErrorRateModel", "Inner", StringValue ("ns3::YansErrorRateModel"));
+    }
+  else
+    {
+      wifiPhy.SetErrorRateModel ("ns3::YansErrorRateModel");
+    }
   wifiHelper.SetRemoteStationManager ("ns3::ConstantRateWifiManager",
                                       "DataMode", StringValue (phyRate),
                                       "ControlMode", StringValue ("HtMcs0"));
@@ -186,11 +212,12 @@ main(int argc, char *argv[])
   Simulator::Destroy ();
 
   double averageThroughput = ((sink->GetTotalRx() * 8) / (1e6  * simulationTime));
-  if (averageThroughput < 50)
+  std::cout << "\nAverage throughtput: " << averageThroughput << " Mbit/s" << std::endl;
+  report.AddKpi ("throughput", averageThroughput);
+  if (report.Finish (benchmark, recordBenchmark, std::cout) > 0)
     {
       NS_LOG_ERROR ("Obtained throughput is not in the expected boundaries!");
       exit (1);
     }
-  std::cout << "\nAverage throughtput: " << averageThroughput << " Mbit/s" << std::endl;
   return 0;
 }
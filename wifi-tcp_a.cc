@@ -39,6 +39,10 @@
 #include "ns3/network-module.h"
 #include "ns3/point-to-point-module.h"
 #include "ns3/wifi-module.h"
+#include "traffic-matrix.h"
+/* This program replaces operator new with the pool (packet-pool.h). */
+#define PACKET_POOL_REPLACE_NEW
+#include "packet-pool.h"
 
 NS_LOG_COMPONENT_DEFINE ("wifi-tcp");
 
@@ -53,6 +57,8 @@ main(int argc, char *argv[])
   std::string phyRate = "HtMcs7";                    /* Physical layer bitrate. */
   double simulationTime = 10;                        /* Simulation time in seconds. */
   bool pcapTracing = false;                          /* PCAP Tracing is enabled or not. */
+  std::string trafficMatrix;                         /* Traffic matrix file, empty for all pairs. */
+  bool packetPool = true;                            /* Recycle packet allocations through free lists. */
   uint32_t rtsThreshold = 65535;                         
   bool shortGuardInterval = false;
   std::string staManager = "ns3::MinstrelHtWifiManager";
@@ -67,8 +73,12 @@ main(int argc, char *argv[])
   cmd.AddValue ("phyRate", "Physical layer bitrate", phyRate);
   cmd.AddValue ("simulationTime", "Simulation time in seconds", simulationTime);
   cmd.AddValue ("pcap", "Enable/disable PCAP Tracing", pcapTracing);
+  cmd.AddValue ("trafficMatrix", "Traffic matrix file, one \"src dst rateMbps\" per line (default: all pairs)", trafficMatrix);
+  cmd.AddValue ("packetPool", "Recycle the packet, tag, event and callback allocations through per-thread free lists", packetPool);
   cmd.Parse (argc, argv);
 
+  PacketPool::Enable (packetPool);
+
   /* No fragmentation and no RTS/CTS */
   Config::SetDefault ("ns3::WifiRemoteStationManager::FragmentationThreshold", StringValue ("999999"));
   Config::SetDefault ("ns3::WifiRemoteStationManager::RtsCtsThreshold", StringValue ("999999"));
@@ -144,25 +154,13 @@ main(int argc, char *argv[])
   // sink = StaticCast<PacketSink> (sinkApp.Get(0));
 
   /* Install TCP/UDP Transmitter on the station */  
-  ApplicationContainer serverApp;
-  // srand(time(NULL));
-          
-  for(int sender=0;sender<8;sender++)
-  {
-
-    double valself=0.65/56.0;
-    for(int rcv=0;rcv<8;rcv++)
-    {                
-        if(sender==rcv) continue;
-        OnOffHelper server ("ns3::TcpSocketFactory", (InetSocketAddress (staInterface.GetAddress (rcv), 9)));
-        server.SetAttribute ("PacketSize", UintegerValue (payloadSize));
-        server.SetAttribute ("OnTime", StringValue ("ns3::ConstantRandomVariable[Constant=1]"));
-        server.SetAttribute ("OffTime", StringValue ("ns3::ConstantRandomVariable[Constant=0]"));
-        server.SetAttribute ("DataRate", DataRateValue (DataRate (std::to_string(valself)+"Mbps")));
-        serverApp.Add(server.Install(staNodes.Get(sender)));    
-    }            
-  }
- 
+  TrafficMatrix matrix = trafficMatrix.empty () ? TrafficMatrix::AllPairs (8, 0.65e6)
+                                                : TrafficMatrix::Load (trafficMatrix, 8);
+  TrafficMatrixInstaller server ("ns3::TcpSocketFactory", 9);
+  server.SetAttribute ("PacketSize", UintegerValue (payloadSize));
+  server.SetAttribute ("OnTime", StringValue ("ns3::ConstantRandomVariable[Constant=1]"));
+  server.SetAttribute ("OffTime", StringValue ("ns3::ConstantRandomVariable[Constant=0]"));
+  ApplicationContainer serverApp = server.Install (matrix, staNodes, staInterface);
 
   sinkApp.Start (Seconds (0.0));
   sinkApp.Stop (Seconds (simulationTime + 1));
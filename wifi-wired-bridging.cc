@@ -42,6 +42,12 @@
 //               | AP Node |              | AP Node |
 //               +---------+              +---------+
 //
+// With --processes=N the BSSs are split across N local processes, BSS i
+// going to process i % N (see process-partition.h).  The CSMA backbone is
+// then replaced by a BackboneChannel whose --backboneDelay is the lookahead
+// the processes synchronize on, and flows are measured by a
+// PartitionFlowProbe instead of FlowMonitor.
+//
 
 #include "ns3/core-module.h"
 #include "ns3/mobility-module.h"
@@ -59,29 +65,45 @@
  #include<math.h>
 #include "ns3/point-to-point-module.h"
 #include "ns3/flow-monitor-module.h"
+#include "sweep-runner.h"
+#include "sample-stats.h"
+#include "flow-index.h"
+#include "async-pcap-writer.h"
+#include "benchmark-report.h"
+#include "grid-channel-index.h"
+#include "process-partition.h"
+#include "partition-flow-probe.h"
 
 using namespace ns3;
 
+uint32_t nWifis = 2;
+bool sendIp = true;
+bool writeMobility = false;
+bool gridChannel = false;                          /* Send only to the PHYs in range (grid-channel-index.h). */
+uint32_t firstRun = 1;                             /* RngRun of the first replica. */
+uint32_t processes = 1;                            /* Processes the BSSs are split across. */
+double backboneDelay = 50;                         /* Backbone delay in us when split: the lookahead. */
 
-int getindex(int i)
-{
-  if(i<10)
-  {
-    return i-2;
-  }
-  else
-  {
-    return i-3;
-  }
-}
 
-int main (int argc, char *argv[])
+/*
+ * Runs replica number index with RngRun firstRun + index and returns
+ * "net1 net2 delay jitter" for the replication summary.
+ */
+std::string
+RunReplica (uint32_t index)
 {
-  uint32_t nWifis = 2;
+  uint32_t run = firstRun + index;
+  RngSeedManager::SetRun (run);
+
+  std::ostringstream tag;
+  tag << "-r" << run;
+
+  /* With --processes, every process builds and simulates its share of the BSSs. */
+  ProcessPartition partition (processes);
+  bool distributed = partition.GetN () > 1;
+
   uint32_t nStas[2]={8,4};
   //uint32_t nStas = 2;
-  bool sendIp = true;
-  bool writeMobility = false;
   int totalrate=3.3;
 
   uint32_t payloadSize = 1472;                       /* Transport layer payload size in bytes. */
@@ -103,13 +125,6 @@ int main (int argc, char *argv[])
 
   std::string phyMode ("DsssRate11Mbps");
 
-  CommandLine cmd;
-  cmd.AddValue ("nWifis", "Number of wifi networks", nWifis);
-  // cmd.AddValue ("nStas", "Number of stations per wifi network", nStas);
-  cmd.AddValue ("SendIp", "Send Ipv4 or raw packets", sendIp);
-  cmd.AddValue ("writeMobility", "Write mobility trace", writeMobility);
-  cmd.Parse (argc, argv);
-
   NodeContainer backboneNodes;
   NetDeviceContainer backboneDevices;
   Ipv4InterfaceContainer backboneInterfaces;
@@ -118,6 +133,8 @@ int main (int argc, char *argv[])
   std::vector<NetDeviceContainer> apDevices;
   std::vector<Ipv4InterfaceContainer> staInterfaces;
   std::vector<Ipv4InterfaceContainer> apInterfaces;
+  std::vector<std::vector<Ipv4Address> > staAddresses;
+  NodeContainer localNodes;
 
   InternetStackHelper stack;
   CsmaHelper csma;
@@ -125,9 +142,19 @@ int main (int argc, char *argv[])
   ip.SetBase ("192.168.0.0", "255.255.255.0");
 
   backboneNodes.Create (nWifis);
-  stack.Install (backboneNodes);
-
-  backboneDevices = csma.Install (backboneNodes);
+  Ptr<BackboneChannel> backboneChannel;
+  if (distributed)
+    {
+      /* Every process has every AP node, but only its own get a stack and a port. */
+      backboneChannel = CreateObject<BackboneChannel> ();
+      backboneChannel->SetAttribute ("Delay", TimeValue (MicroSeconds (backboneDelay)));
+      partition.SetChannel (backboneChannel);
+    }
+  else
+    {
+      stack.Install (backboneNodes);
+      backboneDevices = csma.Install (backboneNodes);
+    }
 
   double wifiX = 0.0;
 
@@ -136,6 +163,25 @@ int main (int argc, char *argv[])
 
   for (uint32_t i = 0; i < nWifis; ++i)
     {
+      if (!partition.IsLocal (i))
+        {
+          /* Another process builds this BSS: only keep its addresses taken. */
+          std::vector<Ipv4Address> addresses;
+          ip.NewAddress ();
+          for (uint32_t k = 0; k < nStas[i]; ++k)
+            {
+              addresses.push_back (ip.NewAddress ());
+            }
+          staAddresses.push_back (addresses);
+          staNodes.push_back (NodeContainer ());
+          apDevices.push_back (NetDeviceContainer ());
+          apInterfaces.push_back (Ipv4InterfaceContainer ());
+          staDevices.push_back (NetDeviceContainer ());
+          staInterfaces.push_back (Ipv4InterfaceContainer ());
+          wifiX += 20.0;
+          continue;
+        }
+
       // calculate ssid for wifi subnetwork
       std::ostringstream oss;
       oss << "wifi-default-" << i;
@@ -161,7 +207,8 @@ int main (int argc, char *argv[])
       wifiChannel.SetPropagationDelay ("ns3::ConstantSpeedPropagationDelayModel");
       wifiChannel.AddPropagationLoss("ns3::LogDistancePropagationLossModel", "ReferenceLoss", DoubleValue (40.0459));
 
-      wifiPhy.SetChannel(wifiChannel.Create());
+      Ptr<YansWifiChannel> channel = wifiChannel.Create();
+      wifiPhy.SetChannel(channel);
       //Add a non-Qos upper mac, and disable the rate control
       NqosWifiMacHelper wifiMac = NqosWifiMacHelper::Default();
 
@@ -183,8 +230,23 @@ int main (int argc, char *argv[])
                        "Ssid", SsidValue (ssid));
       apDev = wifi.Install (wifiPhy, wifiMac, backboneNodes.Get (i));
 
+      Ptr<NetDevice> backboneDevice;
+      if (distributed)
+        {
+          stack.Install (backboneNodes.Get (i));
+          Ptr<BackboneNetDevice> port = CreateObject<BackboneNetDevice> ();
+          port->SetAddress (ProcessPartition::MakeAddress (i, 1));
+          backboneNodes.Get (i)->AddDevice (port);
+          port->SetChannel (backboneChannel);
+          backboneDevice = port;
+        }
+      else
+        {
+          backboneDevice = backboneDevices.Get (i);
+        }
+
       NetDeviceContainer bridgeDev;
-      bridgeDev = bridge.Install (backboneNodes.Get (i), NetDeviceContainer (apDev, backboneDevices.Get (i)));
+      bridgeDev = bridge.Install (backboneNodes.Get (i), NetDeviceContainer (apDev, backboneDevice));
 
       // assign AP IP address to bridge, not wifi
       apInterface = ip.Assign (bridgeDev);
@@ -202,6 +264,32 @@ int main (int argc, char *argv[])
       staDev = wifi.Install (wifiPhy, wifiMac, sta);
       staInterface = ip.Assign (staDev);
 
+      std::vector<Ipv4Address> addresses;
+      for (uint32_t k = 0; k < staInterface.GetN (); ++k)
+        {
+          addresses.push_back (staInterface.GetAddress (k));
+        }
+      staAddresses.push_back (addresses);
+      if (distributed)
+        {
+          bridgeDev.Get (0)->SetAddress (ProcessPartition::MakeAddress (i, 0));
+          apDev.Get (0)->SetAddress (ProcessPartition::MakeAddress (i, 2));
+          for (uint32_t k = 0; k < staDev.GetN (); ++k)
+            {
+              staDev.Get (k)->SetAddress (ProcessPartition::MakeAddress (i, 3 + k));
+            }
+        }
+      localNodes.Add (backboneNodes.Get (i));
+      localNodes.Add (sta);
+
+      if (gridChannel)
+        {
+          // The stations walk at 1 m/s.
+          Ptr<GridChannelIndex> index = Create<GridChannelIndex> ();
+          index->SetRefresh (Seconds (1.0), 1.0);
+          index->Install (channel, NetDeviceContainer (apDev, staDev));
+        }
+
       // save everything in containers.
       staNodes.push_back (sta);
       apDevices.push_back (apDev);
@@ -227,13 +315,18 @@ int main (int argc, char *argv[])
 
   /* Install TCP/UDP Transmitter on the station */  
   ApplicationContainer serverApp;//1,serverApp2;
-  srand(time(NULL));
+  Ptr<UniformRandomVariable> split = CreateObject<UniformRandomVariable> ();
+  if (distributed)
+    {
+      /* Every process must draw the same rates. */
+      split->SetStream (0);
+    }
 
-  int x=rand()%totalrate;
-  int y=rand()%(totalrate-x);
+  int x=split->GetInteger (0, totalrate-1);
+  int y=split->GetInteger (0, totalrate-x-1);
   
   
-  for(int sender=0;sender<8;sender++)
+  for(int sender=0;sender<8 && partition.IsLocal (0);sender++)
   {
 
      double valself=(x*1.0)/56.0;
@@ -241,7 +334,7 @@ int main (int argc, char *argv[])
     {
         
         if(sender==rcv) continue;
-        OnOffHelper server ("ns3::TcpSocketFactory", (InetSocketAddress (staInterfaces[0].GetAddress (rcv), 9)));
+        OnOffHelper server ("ns3::TcpSocketFactory", (InetSocketAddress (staAddresses[0][rcv], 9)));
         server.SetAttribute ("PacketSize", UintegerValue (payloadSize));
         server.SetAttribute ("OnTime", StringValue ("ns3::ConstantRandomVariable[Constant=1]"));
         server.SetAttribute ("OffTime", StringValue ("ns3::ConstantRandomVariable[Constant=0]"));
@@ -252,7 +345,7 @@ int main (int argc, char *argv[])
     for(int rcv=0;rcv<4;rcv++)
     {
         
-        OnOffHelper server ("ns3::TcpSocketFactory", (InetSocketAddress (staInterfaces[1].GetAddress (rcv), 9)));
+        OnOffHelper server ("ns3::TcpSocketFactory", (InetSocketAddress (staAddresses[1][rcv], 9)));
         server.SetAttribute ("PacketSize", UintegerValue (payloadSize));
         server.SetAttribute ("OnTime", StringValue ("ns3::ConstantRandomVariable[Constant=1]"));
         server.SetAttribute ("OffTime", StringValue ("ns3::ConstantRandomVariable[Constant=0]"));
@@ -264,13 +357,13 @@ int main (int argc, char *argv[])
 
 
 
-  for(int sender=0;sender<4;sender++)
+  for(int sender=0;sender<4 && partition.IsLocal (1);sender++)
   {     
     double valself=(x*1.0)/(12.0);
     for(int rcv=0;rcv<4;rcv++)
     {
         if(sender==rcv) continue;
-        OnOffHelper server ("ns3::TcpSocketFactory", (InetSocketAddress (staInterfaces[1].GetAddress (rcv), 9)));
+        OnOffHelper server ("ns3::TcpSocketFactory", (InetSocketAddress (staAddresses[1][rcv], 9)));
         server.SetAttribute ("PacketSize", UintegerValue (payloadSize));
         server.SetAttribute ("OnTime", StringValue ("ns3::ConstantRandomVariable[Constant=1]"));
         server.SetAttribute ("OffTime", StringValue ("ns3::ConstantRandomVariable[Constant=0]"));
@@ -281,7 +374,7 @@ int main (int argc, char *argv[])
     for(int rcv=0;rcv<8;rcv++)
     {
           
-        OnOffHelper server ("ns3::TcpSocketFactory", (InetSocketAddress (staInterfaces[0].GetAddress (rcv), 9)));
+        OnOffHelper server ("ns3::TcpSocketFactory", (InetSocketAddress (staAddresses[0][rcv], 9)));
         server.SetAttribute ("PacketSize", UintegerValue (payloadSize));
         server.SetAttribute ("OnTime", StringValue ("ns3::ConstantRandomVariable[Constant=1]"));
         server.SetAttribute ("OffTime", StringValue ("ns3::ConstantRandomVariable[Constant=0]"));
@@ -325,7 +418,17 @@ int main (int argc, char *argv[])
    
        
 
-  Ptr<FlowMonitor> flowMonitor = flowHelper.InstallAll();
+  /* FlowMonitor cannot follow the flows that cross processes. */
+  Ptr<FlowMonitor> flowMonitor;
+  PartitionFlowProbe probe;
+  if (distributed)
+    {
+      probe.Install (localNodes);
+    }
+  else
+    {
+      flowMonitor = flowHelper.InstallAll();
+    }
   
   // Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier>(flowHelper.GetClassifier()); 
   // Ptr<FlowMonitor> monitor1 = flowHelper.GetMonitor();
@@ -333,8 +436,9 @@ int main (int argc, char *argv[])
   // Ptr<FlowMonitor> fm=flowHelper.InstallAll(ap.get(0));
   
 
-  wifiPhy.EnablePcap ("wifi-wired-bridging", apDevices[0]);
-  wifiPhy.EnablePcap ("wifi-wired-bridging", apDevices[1]);
+  AsyncPcapWriter pcap;
+  pcap.EnableWifi ("wifi-wired-bridging" + tag.str (), apDevices[0]);
+  pcap.EnableWifi ("wifi-wired-bridging" + tag.str (), apDevices[1]);
 
   // if (writeMobility)
   //   {
@@ -342,36 +446,63 @@ int main (int argc, char *argv[])
   //     MobilityHelper::EnableAsciiAll (ascii.CreateFileStream ("wifi-wired-bridging.mob"));
   //   }
 
-  Simulator::Stop (Seconds (simulationTime + 1));
-  Simulator::Run ();
+  partition.Run (Seconds (simulationTime + 1));
+  pcap.Close ();
+  if (distributed && partition.GetRank () == 0)
+    {
+      NS_LOG_UNCOND ("Synchronization windows: " << partition.GetWindows ());
+    }
 
 
-  double matrix[12][12];
-  for(int i=0;i<12;i++)
-  {
-    for(int j=0;j<12;j++)
+  /* Throughput between every pair of stations, network 1's stations first. */
+  NodeIndexMap stationIndex;
+  for (uint32_t i = 0; i < staInterfaces.size (); ++i)
     {
-      matrix[i][j]=0.0;
+      for (uint32_t k = 0; k < staAddresses[i].size (); ++k)
+        {
+          stationIndex.Add (staAddresses[i][k]);
+        }
+    }
+  FlowMatrix matrix (stationIndex.GetN ());
+
+  std::map<FlowId, FlowMonitor::FlowStats> stats;
+  std::map<FlowId, Ipv4FlowClassifier::FiveTuple> tuples;
+  if (distributed)
+    {
+      /* Rank 0 reports for the whole partition. */
+      std::vector<std::string> parts = partition.Gather (probe.Serialize ());
+      if (partition.GetRank () != 0)
+        {
+          Simulator::Destroy ();
+          partition.ExitIfChild ();
+        }
+      PartitionFlowProbe::Merge (parts, stats, tuples);
+    }
+  else
+    {
+      flowMonitor->CheckForLostPackets ();
+      Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier> (flowHelper.GetClassifier ());
+      stats = flowMonitor->GetFlowStats ();
+      for (std::map<FlowId, FlowMonitor::FlowStats>::const_iterator iter = stats.begin (); iter != stats.end (); ++iter)
+        {
+          tuples[iter->first] = classifier->FindFlow (iter->first);
+        }
     }
-  }
-  
-  flowMonitor->CheckForLostPackets ();
-  Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier> (flowHelper.GetClassifier ());
-  std::map<FlowId, FlowMonitor::FlowStats> stats = flowMonitor->GetFlowStats ();
   // double tput_1=0;
   // double tput_2=0;
+  double delaySum=0.0;
+  double jitterSum=0.0;
+  double rxPackets=0.0;
 
   for (std::map<FlowId, FlowMonitor::FlowStats>::const_iterator iter = stats.begin (); iter != stats.end (); ++iter){
     // cout<<iter->first;
 
 
-      Ipv4FlowClassifier::FiveTuple t = classifier->FindFlow (iter->first);
+      Ipv4FlowClassifier::FiveTuple t = tuples[iter->first];
 
       
-      uint32_t saddress=t.sourceAddress.Get();
-      int index1=getindex(saddress%3232235520);
-      uint32_t daddress=t.destinationAddress.Get();
-      int index2=getindex(daddress%3232235520);
+      int32_t index1=stationIndex.Lookup (t.sourceAddress);
+      int32_t index2=stationIndex.Lookup (t.destinationAddress);
 
       
 
@@ -385,7 +516,13 @@ int main (int argc, char *argv[])
       NS_LOG_UNCOND("DelaySum = " << iter->second.delaySum);
 
       double tput=iter->second.rxBytes * 8.0 / (iter->second.timeLastRxPacket.GetSeconds()-iter->second.timeFirstTxPacket.GetSeconds()) / 1024 ;
-      matrix[index1][index2]+=tput;
+      if (index1 >= 0 && index2 >= 0)
+        {
+          matrix.Add (index1, index2, tput);
+        }
+      delaySum+=iter->second.delaySum.GetSeconds();
+      jitterSum+=iter->second.jitterSum.GetSeconds();
+      rxPackets+=iter->second.rxPackets;
       NS_LOG_UNCOND("Throughput: " << tput << " Kbps");
      
       // th_put[index]=tput;
@@ -408,40 +545,15 @@ NS_LOG_UNCOND("\n\nReport\n\n");
 
        NS_LOG_UNCOND("size: " << serverApp.GetN() << " Kbps");
       
-double totalsum=0.0;
+double totalsum=matrix.GetTotal ();
 double net1=0.0;
 double net2=0.0;
-for(int i=0;i<12;i++)
-{
-  for(int j=0;j<12;j++)
-  {
-    totalsum+=matrix[i][j];
-    std::cout<<matrix[i][j]<<" ";
-  }
-  std::cout<<std::endl;
-}
+matrix.Print (std::cout);
 
-double temp1=0.0;
-double temp2=0.0;
-for(int i=0;i<8;i++)
-{
-  for(int j=0;j<8;j++)
-  {
-    temp1+=matrix[i][j];
-    
-  }
-  
-}
-
-for(int i=8;i<12;i++)
-{
-  for(int j=8;j<12;j++)
-  {
-    temp2+=matrix[i][j];
-    
-  }
-  
-}
+/* Traffic staying inside network 1, and inside network 2. */
+uint32_t n1=staAddresses[0].size ();
+double temp1=matrix.GetSum (0, n1, 0, n1);
+double temp2=matrix.GetSum (n1, matrix.GetN (), n1, matrix.GetN ());
 net1=totalsum-temp2;
 net2=totalsum-temp1;
 std::cout<<"network1 : "<<net1<< std::endl;
@@ -452,12 +564,86 @@ std::cout<<std::endl;std::cout<<std::endl;std::cout<<std::endl;std::cout<<std::e
 
 
 
-flowMonitor->SerializeToXmlFile("report1.xml", true, true);
+if (!distributed)
+  {
+    flowMonitor->SerializeToXmlFile("report1" + tag.str () + ".xml", true, true);
+  }
   
 
   Simulator::Destroy ();
 
-  
+  std::ostringstream result;
+  result << net1 << " " << net2 << " "
+         << (rxPackets > 0 ? delaySum / rxPackets : 0) << " "
+         << (rxPackets > 1 ? jitterSum / (rxPackets - 1) : 0) << "\n";
+  return result.str ();
+}
+
+int main (int argc, char *argv[])
+{
+  uint32_t replications = 1;
+  uint32_t jobs = 0;
+  std::string benchmark;
+  bool recordBenchmark = false;
+
+  CommandLine cmd;
+  cmd.AddValue ("nWifis", "Number of wifi networks", nWifis);
+  // cmd.AddValue ("nStas", "Number of stations per wifi network", nStas);
+  cmd.AddValue ("SendIp", "Send Ipv4 or raw packets", sendIp);
+  cmd.AddValue ("writeMobility", "Write mobility trace", writeMobility);
+  cmd.AddValue ("processes", "Local processes the BSSs are split across", processes);
+  cmd.AddValue ("backboneDelay", "Backbone delay in us when split across processes (the lookahead)", backboneDelay);
+  cmd.AddValue ("gridChannel", "Deliver each frame only to the PHYs above the detection threshold", gridChannel);
+  cmd.AddValue ("replications", "Independent runs (RngRun values)", replications);
+  cmd.AddValue ("jobs", "Number of replicas run in parallel (0: one per core)", jobs);
+  cmd.AddValue ("benchmark", "Check the run against this bands file", benchmark);
+  cmd.AddValue ("recordBenchmark", "Write the --benchmark bands file from this run instead of checking it", recordBenchmark);
+  cmd.Parse (argc, argv);
+  /* nStas and the traffic below are written for exactly two BSSs. */
+  NS_ABORT_MSG_IF (nWifis != 2, "--nWifis=" << nWifis << ": this scenario has two networks of 8 and 4 stations");
+
+  BenchmarkReport report ("wifi-wired-bridging");
+  if (!benchmark.empty ())
+    {
+      report.Start ();
+    }
+
+  /* --RngRun selects the run number of the first replica. */
+  firstRun = RngSeedManager::GetRun ();
+
+  SweepRunner runner;
+  runner.SetMaxJobs (jobs);
+  std::vector<std::string> results = runner.Run (replications, MakeCallback (&RunReplica));
+
+  SampleStats net1, net2, delay, jitter;
+  for (uint32_t r = 0; r < replications; ++r)
+    {
+      double n1, n2, d, j;
+      std::istringstream in (results[r]);
+      in >> n1 >> n2 >> d >> j;
+      net1.Add (n1);
+      net2.Add (n2);
+      delay.Add (d);
+      jitter.Add (j);
+    }
+  std::cout << "replications : " << replications << std::endl;
+  std::cout << "network1 : " << net1.GetMean () << " +- " << net1.GetConfidenceHalfWidth () << " Kbps" << std::endl;
+  std::cout << "network2 : " << net2.GetMean () << " +- " << net2.GetConfidenceHalfWidth () << " Kbps" << std::endl;
+  std::cout << "delay : " << delay.GetMean () << " +- " << delay.GetConfidenceHalfWidth () << " s" << std::endl;
+  std::cout << "jitter : " << jitter.GetMean () << " +- " << jitter.GetConfidenceHalfWidth () << " s" << std::endl;
+
+  if (!benchmark.empty ())
+    {
+      report.AddKpi ("network1", net1.GetMean ());
+      report.AddKpi ("network2", net2.GetMean ());
+      report.AddKpi ("delay", delay.GetMean ());
+      report.AddKpi ("jitter", jitter.GetMean ());
+      if (report.Finish (benchmark, recordBenchmark, std::cout) > 0)
+        {
+          return 1;
+        }
+    }
+  return 0;
 
 
 